@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+
+# define EVENT_NONE 0
+# define EVENT_IN   1
+# define EVENT_OUT  2
+# define EVENT_HUP  4
+# define EVENT_ERR  8
+# define EVENT_EDGE 16
+
+// Interest in a connection which the engine may read and write
+// itself, and the event of the operation it has completed
+# define EVENT_STREAM   32
+# define EVENT_COMPLETE 64
+
+// Event engine is the only place that knows how readiness is
+// obtained from the kernel. Server registers descriptors once
+// and then walks the list of ready events returned by wait().
+//
+// Completion-based engine does the I/O itself: it accepts
+// connections of listeners, receives data of streams and
+// sends what it's given. Completed operation is reported with
+// EVENT_COMPLETE: res is the accepted descriptor, the number
+// of received bytes at data (0 is the end of stream, data is
+// valid till the next wait()), or with EVENT_OUT the number
+// of bytes sent.
+//
+// Memory given to send() isn't copied: it should stay valid
+// till the send is reported, and strings given with it are
+// kept by the send till then.
+class AEngine {
+
+public:
+    struct Event {
+        int         fd;
+        uint32_t    events;
+        int         res;
+        const char *data;
+    };
+
+    typedef std::vector<Event>       EventsVec;
+    typedef std::vector<std::string> StringsVec;
+
+protected:
+    EventsVec   _ready;
+    std::size_t _nbReady;
+
+public:
+    AEngine(void);
+    virtual ~AEngine(void);
+
+    virtual int init(void) = 0;
+    virtual int add(int fd, uint32_t events) = 0;
+    virtual int mod(int fd, uint32_t events) = 0;
+    virtual int del(int fd) = 0;
+    virtual int wait(int timeout) = 0;
+
+    virtual const char *name(void) const = 0;
+
+    virtual int  listen(int fd);
+    virtual bool completes(void) const;
+    virtual long send(int fd, const struct iovec *iov, int count, StringsVec &kept);
+    virtual std::size_t sending(int fd) const;
+
+    std::size_t ready(void) const;
+    const Event &operator[](std::size_t i) const;
+
+    static AEngine *create(const std::string &type);
+};
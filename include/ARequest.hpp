@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <limits.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -21,6 +22,17 @@ class Client;
 
 class ARequest {
 
+public:
+    // Piece of a file body: generated frame (like headers of
+    // a part) followed by a range of the open file
+    struct FilePart {
+        std::string frame;
+        uint64_t    offset;
+        uint64_t    size;
+    };
+
+    typedef std::vector<FilePart> FileParts;
+
 private:
     std::string       _protocol;
     int               _major : 4;
@@ -43,6 +55,8 @@ private:
     bool              _isProxy;
     bool              _isCGI;
     bool              _parted;
+    FileParts         _fileParts;
+    bool              _upload;
 
     // Internal status
     StatusCode        _status;
@@ -55,6 +69,7 @@ protected:
     int              _filefd;
     struct stat      _filestat;
     uint64_t         _offset;
+    uint64_t         _outputEnd;
 
 public:
     ARequest(void);
@@ -107,6 +122,14 @@ public:
     bool parted(void) const;
     void parted(bool);
 
+    bool fileBody(void) const;
+    void setFileBody(uint64_t offset, uint64_t size);
+    void addFilePart(const std::string &frame, uint64_t offset, uint64_t size);
+    const FileParts &getFileParts(void) const;
+
+    uint64_t getOutputEnd(void) const;
+    void setOutputEnd(uint64_t);
+
     bool isChunkSize(void) const;
     void isChunkSize(bool);
 
@@ -121,9 +144,7 @@ public:
     virtual bool has(uint32_t hdrhash) = 0;
 
     virtual bool parseLine(std::string &) = 0;
-    virtual StatusCode parseSL(const std::string &) = 0;
     virtual StatusCode checkSL(void) = 0;
-    virtual StatusCode parseHeader(const std::string &) = 0;
     virtual StatusCode checkHeaders(void) = 0;
     
     StatusCode parseBody(const std::string &);
@@ -132,10 +153,15 @@ public:
     StatusCode writeChunk(const std::string &);
     StatusCode writePart(const std::string &);
     
-    std::string makeChunk(void);
+    std::string makeChunk(uint64_t &offset, uint64_t &size);
     std::string makePart(void);
 
     bool createTmpFile(void);
+    bool createUploadFile(const std::string &dir);
+    bool moveUploadFile(const std::string &path);
+    bool uploading(void) const;
+    StatusCode writeUpload(long bytes);
+    bool statFile(void);
     bool mapFile(void);
 
 };
@@ -0,0 +1,42 @@
+#pragma once
+
+#if defined(__linux__)
+    # define WS_AFFINITY
+#endif
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+
+// Placement of reactors and workers on CPUs. Every reactor is
+// pinned to one CPU, workers share a set of them. "auto" puts
+// reactors on separate cores of the first package and workers
+// on the other cores of the same packages. Only CPUs allowed to
+// the process (by its cgroup or taskset) are used.
+class Affinity {
+
+public:
+    typedef std::vector<int> CpusVec;
+
+private:
+    static CpusVec _reactorCpus;
+    static CpusVec _workerCpus;
+
+    static int  allowed(CpusVec &);
+    static int  topology(int cpu, const char *name);
+    static int  package(int cpu);
+    static bool sharesCore(int cpu, const CpusVec &cpus);
+    static void autoReactors(std::size_t reactors, const CpusVec &allowed);
+    static void autoWorkers(const CpusVec &allowed);
+    static int  layout(const std::string &list, const CpusVec &allowed, CpusVec &res);
+    static void pin(const CpusVec &cpus);
+
+public:
+    static bool parse(const std::string &list, CpusVec &cpus);
+    static int  init(std::size_t reactors, const std::string &reactorCpus, const std::string &workerCpus);
+
+    static void pinReactor(std::size_t id);
+    static void pinWorker(void);
+};
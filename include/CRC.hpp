@@ -4,3 +4,4 @@
 #include <stdint.h>
 
 uint32_t crc(const char *buf, std::size_t len);
+uint32_t crcLower(const char *buf, std::size_t len);
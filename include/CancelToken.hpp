@@ -0,0 +1,30 @@
+#pragma once
+
+// Shared between a client and its queued jobs. Client is removed
+// only after it cancels the token, which fails while a worker has
+// claimed it; jobs of a cancelled token are dropped by workers
+// without touching the client. Token is freed with the last
+// reference, so it outlives the client if jobs are still queued.
+class CancelToken {
+
+private:
+    // Bit 0 is the cancelled flag, the rest is the number of claims
+    volatile long _state;
+    volatile long _refs;
+
+public:
+    CancelToken(void);
+
+    void retain(void);
+    void release(void);
+
+    bool claim(void);
+    void unclaim(void);
+    bool cancel(void);
+    bool cancelled(void) const;
+
+private:
+    ~CancelToken(void);
+    CancelToken(const CancelToken &);
+    CancelToken &operator=(const CancelToken &);
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Input buffer made of slabs. Data is appended into the free space
+// of the last slab and consumed from the read cursor of the first
+// one, so taking a line or a piece of body costs only its own length
+// however much data follows it. The first slab is small, the next
+// ones are large; every slab goes back to SlabPool once consumed, so
+// an empty buffer holds no memory.
+class ChainBuffer {
+
+private:
+    // Header is kept at the beginning of the slab memory
+    struct Slab {
+        Slab       *next;
+        std::size_t size;
+        std::size_t beg;
+        std::size_t end;
+
+        char *data(void) {
+            return reinterpret_cast<char *>(this + 1);
+        }
+
+        std::size_t capacity(void) const {
+            return size - sizeof(Slab);
+        }
+    };
+
+    Slab       *_head;
+    Slab       *_tail;
+    std::size_t _size;
+
+public:
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    ChainBuffer(void);
+    ~ChainBuffer(void);
+
+    std::size_t size(void) const;
+    std::size_t held(void) const;
+    bool empty(void) const;
+
+    char *tail(std::size_t &avail);
+    void  commit(std::size_t bytes);
+
+    std::size_t find(char c) const;
+    const char *front(std::size_t &len) const;
+    const char *peek(std::size_t offset, std::size_t &len) const;
+
+    void copy(std::string &out, std::size_t bytes) const;
+
+    void take(std::string &out, std::size_t bytes);
+    long writeTo(int fd, std::size_t bytes);
+    void consume(std::size_t bytes);
+    void clear(void);
+
+private:
+    ChainBuffer(const ChainBuffer &);
+    ChainBuffer &operator=(const ChainBuffer &);
+
+    void popSlab(void);
+};
@@ -5,59 +5,87 @@
 #include <deque>
 #include <string>
 
+#include "CancelToken.hpp"
 #include "Globals.hpp"
 #include "IO.hpp"
 #include "Logger.hpp"
 #include "Request.hpp"
 #include "Response.hpp"
 #include "Status.hpp"
+#include "TimerWheel.hpp"
+#include "Tunnel.hpp"
+
+class Reactor;
 
 namespace HTTP {
 
 class Client {
+    public:
+    enum TimerKind {
+        CLIENT_TIMER = 0,
+        GATEWAY_TIMER
+    };
+
     private:
-    IO *_clientIO;
+    IO  _clientIO;
     IO *_serverIO;
-    IO *_gatewayIO;
+    IO  _gatewayIO;
+
+    Reactor     *_reactor;
+    CancelToken *_token;
 
-    bool _processing;
     bool _shouldBeClosed;
     bool _shouldBeRemoved;
     bool _isTunnel;
+    bool _connecting;
+
+    Tunnel *_tunnel;
 
     std::size_t _nbRequests;
     std::size_t _maxRequests;
     std::time_t _clientTimeout;
     std::time_t _gatewayTimeout;
 
-    std::string _domain;
+    Timer _clientTimer;
+    Timer _gatewayTimer;
 
     std::list<Request *>  _requests;
     std::list<Response *> _responses;
 
     int _id;
 
+    bool _idle;
+    long _idleBytes;
+
 public:
+    // Linked descriptors, counted by the event loop only
     std::size_t links;
 
     Client(void);
     ~Client(void);
 
-    void checkTimeout(void);
+    long footprint(void) const;
+    void checkIdle(void);
+
+    void timeoutExpired(int kind);
 
     void tryReplyResponse(int fd);
     void tryReplyRequest(int fd);
     void tryReceiveResponse(int fd);
     void tryReceiveRequest(int fd);
 
-    bool processing(void) const;
-    void processing(bool);
+    void tryRelay(int fd);
+    void hangup(int fd);
+
+    bool hasPendingOutput(int fd);
+    bool wantsInput(int fd);
 
     bool shouldBeClosed(void) const;
     void shouldBeClosed(bool);
 
     bool isTunnel(void) const;
     void isTunnel(bool);
+    bool relaying(void) const;
 
     const std::string getHostname(void);
 
@@ -73,12 +101,12 @@ public:
     IO  *getClientIO(void);
     IO  *getServerIO(void);
     IO  *getGatewayIO(void);
-    void setClientIO(IO *);
     void setServerIO(IO *);
-    void setGatewayIO(IO *);
 
-    const std::string &getDomainName(void) const;
-    void setDomainName(const std::string &);
+    Reactor *getReactor(void);
+    void setReactor(Reactor *);
+
+    CancelToken *getCancelToken(void);
 
     void checkIfFailed(void);
     void addRequest(void);
@@ -86,10 +114,16 @@ public:
     void removeRequest(void);
     void removeResponse(void);
 
-    void receive(Request *);
+    bool receive(void);
+    void takeRequests(void);
     void receive(Response *);
-    void reply(Request *);
-    void reply(Response *);
+    void parse(Request *);
+    bool queueOutput(ARequest *, IO *, bool copy);
+    void queueFileParts(ARequest *, IO *, bool copy);
+
+    void startTunnel(void);
+    void relay(void);
+    void closeTunnel(void);
 
     ServerBlock *matchServerBlock(const std::string &host);
 };
@@ -45,6 +45,7 @@ enum ConfStatus {
     # define KW_PROXY_PASS       "proxy_pass"
     # define KW_PROXY_DOMAINS    "proxy_domains"
     # define KW_ADD_HEADERS      "add_headers"
+    # define KW_WORKER_POOL      "worker_pool"
 
     # define KW_SETTINGS                 "settings"
     # define KW_MAX_WAIT_CONN            "max_wait_conn"
@@ -55,6 +56,7 @@ enum ConfStatus {
     # define KW_MAX_GATEWAY_TIMEOUT      "max_gateway_timeout"
     # define KW_MAX_URI_LENGTH           "max_uri_length"
     # define KW_MAX_HEADER_FIELD_LENGTH  "max_header_field_length"
+    # define KW_MAX_HEADER_FIELDS        "max_header_fields"
     # define KW_BLIND_PROXY              "blind_proxy"
     # define KW_SESSION_LIFETIME         "session_lifetime"
     # define KW_CHUNK_SIZE               "chunk_size"
@@ -62,6 +64,21 @@ enum ConfStatus {
     # define KW_MAX_RANGE_SIZE           "max_range_size"
     # define KW_COOKIE_HTTP_ONLY         "cookie_http_only"
     # define KW_MAX_REG_UPLOAD_SIZE      "max_reg_upload_size"
+    # define KW_EVENT_ENGINE             "event_engine"
+    # define KW_EDGE_TRIGGERED           "edge_triggered"
+    # define KW_REACTORS                 "reactors"
+    # define KW_ACCEPT_BUDGET            "accept_budget"
+    # define KW_REVERSE_DNS              "reverse_dns"
+    # define KW_REVERSE_DNS_TTL          "reverse_dns_ttl"
+    # define KW_WORKER_DISTRIBUTION      "worker_distribution"
+    # define KW_MAX_WORKERS              "max_workers"
+    # define KW_WORKER_GROW_WAIT         "worker_grow_wait"
+    # define KW_WORKER_GROW_DEPTH        "worker_grow_depth"
+    # define KW_WORKER_IDLE_TIMEOUT      "worker_idle_timeout"
+    # define KW_WORKER_POOLS             "worker_pools"
+    # define KW_MAX_QUEUE                "max_queue"
+    # define KW_REACTOR_CPUS             "reactor_cpus"
+    # define KW_WORKER_CPUS              "worker_cpus"
 
 #endif
 
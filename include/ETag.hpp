@@ -1,5 +1,7 @@
 #pragma once
 
+#include <pthread.h>
+
 #include <map>
 #include <string>
 
@@ -0,0 +1,36 @@
+#pragma once
+
+#ifdef __linux__
+    # define WS_EPOLL
+#endif
+
+#ifdef WS_EPOLL
+
+#include <sys/epoll.h>
+
+#include "AEngine.hpp"
+
+class EpollEngine : public AEngine {
+
+public:
+    typedef std::vector<struct epoll_event> EpollEventsVec;
+
+private:
+    int            _epfd;
+    std::size_t    _registered;
+    EpollEventsVec _events;
+
+public:
+    EpollEngine(void);
+    ~EpollEngine(void);
+
+    int init(void);
+    int add(int fd, uint32_t events);
+    int mod(int fd, uint32_t events);
+    int del(int fd);
+    int wait(int timeout);
+
+    const char *name(void) const;
+};
+
+#endif
@@ -19,6 +19,11 @@
     # define DEFAULT_CONF_PATH "./default/conf.json"
 #endif
 
+// Uploads in progress are written next to their destination
+#ifndef UPLOAD_FILE_PREFIX
+    # define UPLOAD_FILE_PREFIX ".wsupload"
+#endif
+
 #ifndef TIME_STAMP
     #define SEC 1
     #define MIN 60 * SEC
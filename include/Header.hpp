@@ -30,6 +30,7 @@ public:
     virtual bool isValid(void) = 0;
 
     bool parse(const std::string &line, bool trimKey = false);
+    void parse(const char *name, std::size_t nameLen, const char *value, std::size_t valueLen);
 
     std::string toString(void);
 
@@ -1,16 +1,35 @@
 #pragma once
 
+#include <list>
 #include <string>
+#include <errno.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include <cstddef>
 #include <unistd.h>
 #include <arpa/inet.h>
 
+#include "AEngine.hpp"
+#include "ChainBuffer.hpp"
 #include "Logger.hpp"
 #include "Globals.hpp"
 #include "HTML.hpp"
 
 class IO {
+public:
+    // Piece of output: owned bytes, memory of someone
+    // else (kept alive until written) or a file range
+    struct Segment {
+        std::string data;
+        const char *addr;
+        int         fd;
+        off_t       offset;
+        std::size_t size;
+    };
+
+    typedef std::list<Segment> SegmentsQueue;
+
+private:
     int         _fdr;
     int         _fdw;
 
@@ -18,11 +37,20 @@ class IO {
     std::string _addr;
     std::size_t _port;
 
-    std::string _rem;
+    ChainBuffer _rem;
+
+    SegmentsQueue _out;
+    std::size_t   _outPos;
+    std::size_t   _pending;
+    uint64_t      _queued;
+    uint64_t      _written;
 
-    std::string _data;
-    std::size_t _dataSize;
-    std::size_t _dataPos;
+    bool        _full;
+    bool        _eof;
+
+    // Engine which receives and sends for the stream
+    AEngine    *_engine;
+    std::size_t _delivered;
 
 public:
     IO(void);
@@ -31,33 +59,51 @@ public:
     void rdFd(int);
     void wrFd(int);
     void setPort(std::size_t);
-    void setDataPos(std::size_t);
-    void setDataSize(std::size_t);
-    void setData(const std::string &);
     void setAddr(const std::string &);
+    void full(bool);
+    void eof(bool);
+    void engine(AEngine *);
 
     int rdFd(void) const;
     int wrFd(void) const;
     std::size_t getPort(void) const;
-    std::size_t getDataPos(void) const;
-    std::size_t getDataSize(void) const;
-    const std::string &getData(void) const;
     const std::string &getAddr(void) const;
+    bool full(void) const;
+    bool eof(void) const;
+
+    const ChainBuffer &getRem(void) const;
 
-    const std::string &getRem(void) const;
+    void queue(const char *, std::size_t);
+    void queue(int fd, off_t, std::size_t);
+    void take(std::string &);
 
+    std::size_t pending(void) const;
+    uint64_t queued(void) const;
+    uint64_t written(void) const;
+
+    int deliver(const char *, std::size_t);
+    void sent(std::size_t);
     int read(void);
     int write(void);
     int nonblock(void);
     int getline(std::string &, int64_t);
+    long spill(int fd, int64_t);
+    void discard(std::size_t);
 
     int pipe(void);
 
     int socket(int = AF_INET);
     int connect(const sockaddr *, socklen_t);
+    int accept(struct sockaddr_in &);
     int listen(const std::string &addr, std::size_t port);
 
     void clear(void);
 
     void reset(void);
+
+private:
+    int  writeFile(const Segment &);
+    long submit(void);
+    std::size_t backlog(void) const;
+    void consume(std::size_t);
 };
\ No newline at end of file
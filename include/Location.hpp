@@ -34,6 +34,7 @@ private:
     ErrorPagesMap _errorPages;
     URI           _proxy_pass;
     Headers<ResponseHeader> _headers;
+    std::string   _workerPool;
 
 public:
     Location(void);
@@ -53,6 +54,7 @@ public:
     ErrorPagesMap &getErrorPagesRef(void);
     URI           &getProxyPassRef(void);
     const URI     &getProxyPass(void) const;
+    std::string   &getWorkerPoolRef(void);
 
     Headers<ResponseHeader>   &getHeaders(void);
 };
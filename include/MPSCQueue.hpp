@@ -0,0 +1,138 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for many producers and one consumer
+// (ring of cells with sequence numbers). Producers only race for
+// the tail with CAS, the consumer takes everything in one drain().
+// When the ring is full, items go to a locked overflow list, so
+// push never fails and never blocks on the consumer. While the list
+// isn't empty, it takes every push, and it's taken by the consumer
+// only after the ring has been emptied, so the order is kept.
+template<typename T>
+class MPSCQueue {
+
+private:
+    struct Cell {
+        volatile std::size_t seq;
+        T                    data;
+    };
+
+    std::vector<Cell>    _cells;
+    std::size_t          _mask;
+    volatile std::size_t _tail;
+    std::size_t          _head;
+
+    volatile int    _overflowed;
+    std::vector<T>  _overflow;
+    pthread_mutex_t _m_overflow;
+
+public:
+    MPSCQueue(void)
+        : _mask(0)
+        , _tail(0)
+        , _head(0)
+        , _overflowed(0) {
+        pthread_mutex_init(&_m_overflow, NULL);
+    }
+
+    ~MPSCQueue(void) {
+        pthread_mutex_destroy(&_m_overflow);
+    }
+
+    // Capacity is rounded up to a power of two.
+    // Should be called before any push.
+    void init(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        _cells.resize(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            _cells[i].seq = i;
+        }
+        _mask = size - 1;
+        _tail = 0;
+        _head = 0;
+    }
+
+    // Could be called from any thread
+    void push(const T &item) {
+        if (_overflowed) {
+            pushOverflow(item);
+            return ;
+        }
+
+        std::size_t pos = _tail;
+
+        for (;;) {
+            Cell *cell = &_cells[pos & _mask];
+            intptr_t diff = static_cast<intptr_t>(cell->seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (__sync_bool_compare_and_swap(&_tail, pos, pos + 1)) {
+                    cell->data = item;
+                    __sync_synchronize();
+                    cell->seq = pos + 1;
+                    return ;
+                }
+                pos = _tail;
+            } else if (diff < 0) {
+                pushOverflow(item);
+                return ;
+            } else {
+                pos = _tail;
+            }
+        }
+    }
+
+    // Consumer only. Appends all published items to out and returns
+    // their number. Item which is still being written by a producer
+    // stops draining, it's taken next time. So is the overflow list:
+    // the items of the ring were pushed before it.
+    std::size_t drain(std::vector<T> &out) {
+        std::size_t count = 0;
+
+        for (;;) {
+            Cell *cell = &_cells[_head & _mask];
+            if (cell->seq != _head + 1) {
+                break ;
+            }
+            __sync_synchronize();
+            out.push_back(cell->data);
+            __sync_synchronize();
+            cell->seq = _head + _mask + 1;
+            ++_head;
+            ++count;
+        }
+
+        if (_overflowed) {
+            pthread_mutex_lock(&_m_overflow);
+            __sync_synchronize();
+            if (_head == _tail) {
+                count += _overflow.size();
+                out.insert(out.end(), _overflow.begin(), _overflow.end());
+                _overflow.clear();
+                _overflowed = 0;
+            }
+            pthread_mutex_unlock(&_m_overflow);
+        }
+        return count;
+    }
+
+private:
+    MPSCQueue(const MPSCQueue &);
+    MPSCQueue &operator=(const MPSCQueue &);
+
+    void pushOverflow(const T &item) {
+        pthread_mutex_lock(&_m_overflow);
+        _overflow.push_back(item);
+        _overflowed = 1;
+        pthread_mutex_unlock(&_m_overflow);
+    }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <poll.h>
+
+#include "AEngine.hpp"
+
+class PollEngine : public AEngine {
+
+public:
+    typedef std::vector<struct pollfd> PollFdVec;
+    typedef PollFdVec::iterator        iter_pfd;
+
+    typedef std::vector<int>           IndexVec;
+
+private:
+    PollFdVec _pollfds;
+    IndexVec  _index;
+    IndexVec  _free;
+
+public:
+    PollEngine(void);
+    ~PollEngine(void);
+
+    int init(void);
+    int add(int fd, uint32_t events);
+    int mod(int fd, uint32_t events);
+    int del(int fd);
+    int wait(int timeout);
+
+    const char *name(void) const;
+
+private:
+    int find(int fd) const;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AEngine.hpp"
+#include "Client.hpp"
+#include "IO.hpp"
+#include "Logger.hpp"
+#include "MPSCQueue.hpp"
+#include "Stats.hpp"
+#include "TimerWheel.hpp"
+#include "Waker.hpp"
+
+// Reactor is an independent event loop. It owns its listening
+// sockets, engine, clients and descriptors tables, so connection
+// accepted by a reactor is served by it till the end. When there
+// are several reactors, listening sockets are bound with
+// SO_REUSEPORT and kernel shards connections between them.
+class Reactor {
+
+public:
+    static std::size_t count;
+
+    typedef std::vector<IO *>           SocketsVec;
+    typedef std::vector<int>            FdIdVec;
+    typedef std::vector<HTTP::Client *> ClientsVec;
+    typedef ClientsVec::iterator        iter_cv;
+
+    // Link request queued by a worker, client is NULL for unlinking
+    struct Link {
+        int           fd;
+        HTTP::Client *client;
+    };
+    typedef std::vector<Link> LinksVec;
+
+private:
+    int        _id;
+    pthread_t  _thread;
+    AEngine   *_engine;
+    Waker      _waker;
+
+    SocketsVec _sockets;
+    FdIdVec    _connector;
+    FdIdVec    _listeners;
+    ClientsVec _clients;
+    FdIdVec    _freeIds;
+
+    TimerWheel            _timers;
+    TimerWheel::TimersVec _expired;
+
+    // Tables above are written by the event loop only,
+    // workers send their links and arming through the queues
+    MPSCQueue<Link> _q_links;
+    MPSCQueue<int>  _q_armPfds;
+
+    // Drained items, kept to reuse memory
+    LinksVec   _links;
+    FdIdVec    _armPfds;
+    FdIdVec    _newPfds;
+    FdIdVec    _delPfds;
+    ClientsVec _unlinkedClients;
+    ClientsVec _delClients;
+
+public:
+    Reactor(void);
+    ~Reactor(void);
+
+    int id(void) const;
+    int init(void);
+    int create(void);
+    int join(void);
+
+    int addListenSocket(const std::string &addr, std::size_t port);
+
+    void link(int fd, HTTP::Client *);
+    void unlink(int fd);
+    void armWrite(int fd);
+    void disarmWrite(int fd);
+    void schedule(Timer *, std::time_t expires);
+    void wakeup(void);
+
+private:
+    Reactor(const Reactor &);
+    Reactor &operator=(const Reactor &);
+
+    int  initFdTables(void);
+    void loop(void);
+    int  poll(void);
+    void process(void);
+    void connect(std::size_t servid);
+    void accepted(std::size_t servid, int fd);
+    bool addConnection(IO *listener, int fd, const struct sockaddr_in &);
+    void received(int fd, const char *data, int res);
+    void sent(int fd, int res);
+    int  pollTimeout(void);
+    void checkTimeout(void);
+    void checkUnlinkedClients(void);
+    uint32_t interest(bool in, bool out, bool stream) const;
+    bool streamed(HTTP::Client *, int fd) const;
+
+    bool inLoop(void) const;
+    void addClient(HTTP::Client *);
+    void linkFd(int fd, HTTP::Client *);
+    void unlinkFd(int fd);
+    HTTP::Client *linkedClient(int fd);
+
+    void addToNewFdsQ(int);
+    void addToDelFdsQ(int);
+    void addToDelClientQ(HTTP::Client *);
+
+    void emptyLinksQ(void);
+    void emptyNewFdsQ(void);
+    void emptyDelFdsQ(void);
+    void emptyDelClientQ(void);
+
+    void pollin(int fd);
+    void pollhup(int fd);
+    void pollerr(int fd);
+    void pollout(int fd);
+
+    static void *_cycle(void *ptr);
+};
@@ -18,6 +18,7 @@
 #include "Time.hpp"
 #include "Range.hpp"
 #include "ARequest.hpp"
+#include "RequestParser.hpp"
 
 namespace HTTP {
 
@@ -49,6 +50,8 @@ private:
 
     std::map<std::string, std::string> _cookie;
 
+    RequestParser  _parser;
+
 public:
     Headers<RequestHeader>  headers;
 
@@ -74,9 +77,9 @@ public:
     virtual bool has(uint32_t hash);
 
     virtual bool parseLine(std::string &);
-    virtual StatusCode parseSL(const std::string &);
+    std::size_t parseHead(const ChainBuffer &);
+    bool parseUpload(long bytes);
     virtual StatusCode checkSL(void);
-    virtual StatusCode parseHeader(const std::string &);
     virtual StatusCode checkHeaders(void);
 
     const std::string &getPath(void) const;
@@ -110,9 +113,17 @@ public:
     void checkReverseProxy(void);
 
     void checkCGI(void);
+    StatusCode openUpload(void);
 
     void addHeader(uint32_t, const std::string & = "");
 
+private:
+    bool checkFormed(void);
+
+    StatusCode parseSL(const char *head);
+    StatusCode parseField(const char *head, const RequestParser::Field &);
+    StatusCode insertHeader(const RequestHeader &);
+
 };
 
 } // namespace HTTP
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "ChainBuffer.hpp"
+#include "Status.hpp"
+
+namespace HTTP {
+
+// Scanner of a request head, which works right on the input buffer.
+// It's resumed where it has stopped when more data comes, so every
+// byte is looked at once, and nothing is copied: only offsets of the
+// start line parts and of header fields (from the beginning of the
+// buffer) are kept. Strings are made by the request from them.
+class RequestParser {
+
+public:
+    struct Token {
+        std::size_t off;
+        std::size_t len;
+    };
+
+    struct Field {
+        Token name;
+        Token value;
+    };
+
+private:
+    enum State {
+        S_START,
+        S_METHOD,
+        S_SP_URI,
+        S_URI,
+        S_SP_PROTOCOL,
+        S_PROTOCOL,
+        S_SL_TAIL,
+        S_SL_LF,
+        S_FIELD_START,
+        S_NAME,
+        S_OWS,
+        S_VALUE,
+        S_FIELD_LF,
+        S_HEAD_LF,
+        S_DONE
+    };
+
+    State       _state;
+    std::size_t _pos;
+    std::size_t _valueEnd;
+
+    Token       _method;
+    Token       _uri;
+    Token       _protocol;
+
+    // Grows up to max_header_fields, kept for the next head
+    std::vector<Field> _fields;
+    std::size_t        _nbFields;
+
+public:
+    RequestParser(void);
+
+    StatusCode parse(const ChainBuffer &);
+
+    std::size_t length(void) const;
+
+    const Token &method(void) const;
+    const Token &uri(void) const;
+    const Token &protocol(void) const;
+
+    std::size_t fields(void) const;
+    const Field &field(std::size_t) const;
+
+private:
+    StatusCode step(char c);
+    void endLine(char c);
+};
+
+} // namespace HTTP
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <queue>
+#include <string>
+
+#include "Logger.hpp"
+#include "Stats.hpp"
+#include "Time.hpp"
+
+// Reverse DNS resolver. Lookups are done by its own thread, so
+// neither event loop nor workers are blocked by slow DNS servers.
+// Results (failures too) are cached by address for the ttl.
+class Resolver {
+
+public:
+    struct Entry {
+        std::string name;
+        std::time_t expires;
+        bool        done;
+    };
+
+    typedef std::map<std::string, Entry> CacheMap;
+    typedef CacheMap::iterator           iter_cm;
+
+private:
+    pthread_t   _thread;
+    bool        _running;
+    std::time_t _ttl;
+
+    CacheMap                _cache;
+    std::queue<std::string> _q_lookups;
+
+    pthread_mutex_t _m_cache;
+    pthread_cond_t  _c_lookups;
+    pthread_cond_t  _c_done;
+
+public:
+    Resolver(void);
+    ~Resolver(void);
+
+    int  start(std::time_t ttl);
+    void stop(void);
+
+    bool resolve(const std::string &addr, std::string &name, long waitMs);
+
+private:
+    Resolver(const Resolver &);
+    Resolver &operator=(const Resolver &);
+
+    void loop(void);
+    void sweep(std::time_t now);
+    static std::string lookup(const std::string &addr);
+
+    static void *_cycle(void *ptr);
+};
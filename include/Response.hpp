@@ -23,6 +23,7 @@
 #include "Cookie.hpp"
 #include "Globals.hpp"
 #include "ETag.hpp"
+#include "Stats.hpp"
 
 namespace HTTP {
 
@@ -50,6 +51,7 @@ public:
     Response &operator=(const Response &other);
 
     void handle(void);
+    bool isInline(StatsCounter &);
 
     static const std::map<std::string, std::string> MIMEs;
 
@@ -92,6 +94,7 @@ public:
     void        matchCGI(const std::string &filepath);
 
     void        checkCGIFailure(void);
+    bool        hasErrorPage(StatusCode);
     
     virtual bool has(uint32_t hash);
 
@@ -108,9 +111,9 @@ public:
     const std::string getContentRangeValue(RangeSet &);
 
     virtual bool parseLine(std::string &);
-    virtual StatusCode parseSL(const std::string &);
+    StatusCode parseSL(const std::string &);
     virtual StatusCode checkSL(void);
-    virtual StatusCode parseHeader(const std::string &);
+    StatusCode parseHeader(const std::string &);
     virtual StatusCode checkHeaders(void);    
 
     bool writeBodyToFile(const std::string &);
@@ -4,7 +4,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
-#include <poll.h>
+#include <signal.h>
 #include <sys/resource.h>
 #include <unistd.h>
 
@@ -17,15 +17,20 @@
 #include <queue>
 #include <vector>
 
+#include "Affinity.hpp"
 #include "ETag.hpp"
 #include "Client.hpp"
+#include "Reactor.hpp"
+#include "Resolver.hpp"
 #include "Logger.hpp"
 #include "Request.hpp"
 #include "Response.hpp"
 #include "ServerBlock.hpp"
 #include "Utils.hpp"
-#include "Worker.hpp"
+#include "WorkerPool.hpp"
 #include "Settings.hpp"
+#include "Stats.hpp"
+#include "TimerWheel.hpp"
 
 class Server {
     public:
@@ -35,56 +40,35 @@ class Server {
     typedef std::map<std::size_t, ServersList> ServersMap;
     typedef ServersMap::iterator               iter_sm;
 
-    typedef std::vector<struct pollfd> PollFdVec;
-    typedef PollFdVec::iterator        iter_pfd;
-
-    typedef std::vector<IO *>    SocketsVec;
-    typedef SocketsVec::iterator iter_sv;
-
-    typedef std::map<int, int>  FdIdMap;
-    typedef FdIdMap::iterator   iter_fim;
-
-    typedef std::vector<HTTP::Client *> ClientsVec;
-    typedef ClientsVec::iterator          iter_cv;
-
-    typedef std::map<std::string, std::time_t>  SessionsMap;
+    typedef std::map<std::string, Timer>        SessionsMap;
     typedef SessionsMap::iterator               iter_ssm;
 
     typedef std::set<std::string>  HostnamesSet;
     typedef HostnamesSet::iterator iter_hn;
 
+    typedef std::map<std::string, WorkerPool *> WorkerPoolsMap;
+    typedef WorkerPoolsMap::iterator             iter_wpm;
+
     private:
     ServersMap   _servers;
-    SocketsVec   _sockets;
-    FdIdMap      _connector;
-    ClientsVec   _clients;
-    PollFdVec    _pollfds;
     SessionsMap  _sessions;
+    TimerWheel   _sessionTimers;
     HostnamesSet _hostnames;
 
 
-    bool   _working;
-    Worker *_workers;
-
-    pthread_mutex_t _m_new_resp;
+    bool     _working;
+    Reactor *_reactors;
+    Resolver _resolver;
 
-    pthread_mutex_t _m_new_pfds;
-    pthread_mutex_t _m_new_clnt;
+    WorkerPoolsMap _pools;
+    WorkerPool    *_staticPool;
+    WorkerPool    *_cgiPool;
+    WorkerPool    *_proxyPool;
 
-    pthread_mutex_t _m_del_pfds;
-    pthread_mutex_t _m_del_clnt;
+    volatile sig_atomic_t _printStats;
 
-    pthread_mutex_t _m_link;
     pthread_mutex_t _m_sessions;
 
-    std::list<HTTP::Response *> _q_newResponses;
-
-    std::queue<std::pair<int, HTTP::Client *> >  _q_newClients;
-    std::queue<int>                              _q_newPfds;
-
-    std::set<HTTP::Client *>  _q_delClients;
-    std::set<int>             _q_delPfds;
-
     public:
     Settings settings;
     bool isDaemon;
@@ -100,51 +84,28 @@ class Server {
     bool working(void);
     void start(void);
     void finish(void);
+    void printStats(void);
 
-    // void disconnect(int fd);
-    void addToNewFdsQ(int);
-    void addToNewClientQ(int fd, HTTP::Client *);
-    void addToDelFdsQ(int);
-    void addToDelClientQ(HTTP::Client *);
-
-    void addToRespQ(HTTP::Response *);
-    HTTP::Response *rmFromRespQ(void);
-    void rmClientFromRespQ(HTTP::Client *client);
-
-    void link(int fd, HTTP::Client *);
-    void unlink(int fd);
+    bool addToRespQ(HTTP::Response *);
 
     void checkSessionsTimeout(void);
     bool isActualSession(const std::string &s_id);
     void addSession(const std::string s_id);
 
     bool isServerHostname(const std::string &);
+    std::string remoteHost(const std::string &addr);
 
     private:
     int initHostnamesSet(void);
-    void connect(std::size_t servid, int servfd);
 
     void daemonMode(void);
-    int  poll(void);
-    void process(void);
-    void checkTimeout(void);
 
+    int  createReactors(void);
     void createSockets(void);
-    void startWorkers(void);
+    void startReactors(void);
+    void stopReactors(void);
+    int  startWorkers(void);
     void stopWorkers(void);
-
-    int addListenSocket(const std::string &addr, std::size_t port);
-
-    void emptyNewFdsQ(void);
-    void emptyDelFdsQ(void);
-    void emptyNewClientQ(void);
-    void emptyDelClientQ(void);
-
-    void pollin(int fd);
-    void pollhup(int fd);
-    void pollerr(int fd);
-    void pollout(int fd);
-
-    void addClient(HTTP::Client *);
-
+    void printPoolsStats(void);
+    WorkerPool *choosePool(HTTP::Response *);
 };
@@ -1,17 +1,45 @@
 #pragma once
 
 #include <ctime>
+#include <map>
+#include <string>
 #include <stdint.h>
 
 #include "Globals.hpp"
 
+# define WORKER_POOL_STATIC "static"
+# define WORKER_POOL_CGI    "cgi"
+# define WORKER_POOL_PROXY  "proxy"
+
 class Settings {
 
 public:
+    struct WorkerPoolSettings {
+        std::size_t workers;
+        std::size_t max_workers;
+        std::size_t max_queue;
+    };
+
+    typedef std::map<std::string, WorkerPoolSettings> WorkerPoolsMap;
+
     std::size_t max_wait_conn;
+    std::size_t accept_budget;
+
+    std::string event_engine;
+    bool edge_triggered;
+    std::size_t reactors;
     
     std::size_t workers;
+    std::size_t max_workers;
     std::time_t worker_timeout;
+    std::string worker_distribution;
+    std::time_t worker_grow_wait;
+    std::size_t worker_grow_depth;
+    std::time_t worker_idle_timeout;
+    WorkerPoolsMap worker_pools;
+
+    std::string reactor_cpus;
+    std::string worker_cpus;
     
     std::size_t max_requests;
     std::time_t max_client_timeout;
@@ -19,12 +47,16 @@ public:
     
     std::size_t max_uri_length;
     std::size_t max_header_field_length;
+    std::size_t max_header_fields;
     
     bool blind_proxy;
     bool cookie_httpOnly;
     
     std::time_t session_lifetime;
 
+    bool reverse_dns;
+    std::time_t reverse_dns_ttl;
+
     uint64_t chunk_size;
     uint64_t max_reg_file_size;
     uint64_t max_range_size;
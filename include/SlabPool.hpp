@@ -0,0 +1,57 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstddef>
+
+#include "Stats.hpp"
+
+// Memory for input buffers of connections. A buffer starts with a
+// small slab and takes large ones only if a message doesn't fit it;
+// slabs are returned as soon as they are consumed, so idle connections
+// hold none. Returned slabs are kept for reuse up to a limit.
+//
+// Every thread keeps its own short free lists, so a buffer which is
+// emptied and filled again on each request takes no lock (and its
+// byte counters are the thread's own too). Only when a list runs out
+// or overflows, a batch of slabs is moved from or to the shared lists.
+class SlabPool {
+
+public:
+    static const std::size_t SMALL = 2048;
+    static const std::size_t LARGE = 16384;
+
+private:
+    struct FreeSlab {
+        FreeSlab *next;
+    };
+
+    struct FreeList {
+        FreeSlab   *head;
+        std::size_t nb;
+    };
+
+    // Lists of the thread, small and large slabs
+    struct Cache {
+        FreeList lists[2];
+    };
+
+    static FreeList        _shared[2];
+    static pthread_mutex_t _m_slabs;
+    static pthread_key_t   _k_cache;
+    static pthread_once_t  _once;
+
+public:
+    static char *get(std::size_t size);
+    static void  put(char *slab, std::size_t size);
+
+private:
+    static Cache *cache(void);
+    static void   createKey(void);
+    static void   releaseCache(void *);
+
+    static void  push(FreeList &, char *slab);
+    static char *pop(FreeList &);
+    static void  refill(FreeList &, int kind);
+    static void  spill(FreeList &, int kind, std::size_t count);
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "Logger.hpp"
+
+enum StatsCounter {
+    STAT_WAKEUPS = 0,
+    STAT_EVENTS,
+    STAT_WRITE_EVENTS,
+    STAT_SPURIOUS_WRITES,
+    STAT_ACCEPTED,
+    STAT_ACCEPT_ERRORS,
+    STAT_ACCEPT_BUDGET_EXHAUSTED,
+    STAT_LISTEN_OVERFLOWS,
+    STAT_CROSS_THREAD_WAKEUPS,
+    STAT_QUEUED_JOBS,
+    STAT_QUEUE_WAIT_US,
+    STAT_QUEUE_WAIT_MAX_US,
+    STAT_STOLEN_JOBS,
+    STAT_CANCELLED_JOBS,
+    STAT_REJECTED_JOBS,
+    STAT_WORKERS,
+    STAT_WORKERS_SPAWNED,
+    STAT_WORKERS_RETIRED,
+    STAT_INLINE_REDIRECTS,
+    STAT_INLINE_OPTIONS,
+    STAT_INLINE_TRACE,
+    STAT_INLINE_ERRORS,
+    STAT_INLINE_AUTH,
+    STAT_INLINE_NOT_MODIFIED,
+    STAT_DNS_LOOKUPS,
+    STAT_DNS_CACHE_HITS,
+    STAT_CONNECTIONS,
+    STAT_IDLE_CONNECTIONS,
+    STAT_IDLE_CONNECTION_BYTES,
+    STAT_READ_BUFFER_BYTES,
+    STAT_POOLED_BUFFER_BYTES,
+    STAT_TUNNELS,
+    STAT_TUNNEL_BYTES,
+    STAT_COUNT
+};
+
+// Process-wide counters. They could be updated from any thread
+// without locking and are printed on SIGUSR1 and at shutdown.
+//
+// Counters updated on every wakeup or event are kept by each thread
+// on its own (incLocal/addLocal), so threads don't fight over the
+// cache line of a shared counter. get() sums them up.
+class Stats {
+
+private:
+    struct Local {
+        volatile long counters[STAT_COUNT];
+        Local        *next;
+    };
+
+    static volatile long   _counters[STAT_COUNT];
+    static const char     *_names[STAT_COUNT];
+    static long            _listenOverflows;
+
+    static Local          *_locals;
+    static pthread_mutex_t _m_locals;
+    static pthread_key_t   _k_local;
+    static pthread_once_t  _once;
+
+    static long readListenOverflows(void);
+
+    static Local *local(void);
+    static void   createKey(void);
+    static void   releaseLocal(void *);
+
+public:
+    static void init(void);
+
+    static void inc(StatsCounter);
+    static void add(StatsCounter, long);
+    static void incLocal(StatsCounter);
+    static void addLocal(StatsCounter, long);
+    static void set(StatsCounter, long);
+    static void max(StatsCounter, long);
+    static long get(StatsCounter);
+
+    static void print(void);
+};
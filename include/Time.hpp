@@ -1,5 +1,8 @@
 #pragma once
 
+#include <stdint.h>
+#include <sys/time.h>
+
 #include <ctime>
 #include <string>
 
@@ -11,6 +14,7 @@ namespace Time {
     std::string time2str(struct tm *t, const char *f);
 
     time_t now(void);
+    uint64_t usec(void);
 
     std::string local(time_t t = now(), const char *f = f_loc);
     std::string local(const char *f, time_t t = now());
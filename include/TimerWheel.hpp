@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <vector>
+
+// Timer is embedded into its owner, so scheduling never allocates.
+// kind and data tell the owner which of its timers has expired.
+struct Timer {
+    std::time_t expires;
+    int         kind;
+    void       *data;
+
+    Timer *prev;
+    Timer *next;
+
+    Timer(int kind = 0, void *data = NULL);
+
+    bool scheduled(void) const;
+};
+
+// Hierarchical timing wheel with one second ticks. Timers are kept
+// in slots by their expiration time, far ones on upper levels, and
+// are moved down when their slot comes. Adding, removing and each
+// tick cost O(1), only expired timers are touched.
+class TimerWheel {
+
+public:
+    static const int bits = 6;
+    static const int slots = 1 << bits;
+    static const int levels = 4;
+
+    typedef std::vector<Timer *> TimersVec;
+
+private:
+    Timer       _wheel[levels][slots];
+    std::time_t _current;
+    std::size_t _size;
+
+public:
+    TimerWheel(void);
+    ~TimerWheel(void);
+
+    void add(Timer *, std::time_t expires);
+    void remove(Timer *);
+    void advance(std::time_t now, TimersVec &expired);
+    long nextTimeout(std::time_t now) const;
+    std::size_t size(void) const;
+
+private:
+    TimerWheel(const TimerWheel &);
+    TimerWheel &operator=(const TimerWheel &);
+
+    void place(Timer *, std::time_t at);
+    void cascade(int level, int slot);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Relay of a CONNECT tunnel, the HTTP parser isn't involved. Every
+// direction moves data from one socket to the other through its own
+// pipe with splice(), so bytes never come to userspace. A direction
+// reads only when its pipe is empty, so a slow receiver stops reading
+// from the sender and TCP windows do the rest of backpressure. Bytes
+// which came before the tunnel was set up are written first.
+class Tunnel {
+
+private:
+    struct Direction {
+        int         from;
+        int         to;
+        int         pipe[2];
+        std::size_t inPipe;
+        std::string data;
+        bool        eof;
+        bool        closed;
+    };
+
+    Direction _up;
+    Direction _down;
+
+public:
+    Tunnel(void);
+    ~Tunnel(void);
+
+    int  init(int clientFd, int gatewayFd, const std::string &early);
+    long relay(void);
+    void hangup(int fd);
+
+    bool wantsInput(int fd) const;
+    bool wantsOutput(int fd) const;
+    bool finished(void) const;
+
+private:
+    Tunnel(const Tunnel &);
+    Tunnel &operator=(const Tunnel &);
+
+    long pump(Direction &);
+    long fill(Direction &);
+    long flush(Direction &);
+    void drain(Direction &);
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+    # define WS_URING
+# endif
+#endif
+
+#ifdef WS_URING
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/socket.h>
+
+#include "AEngine.hpp"
+
+// io_uring engine. Interest is expressed by requests put into the
+// submission ring, so adding, changing and removing descriptors costs
+// no syscall: all of them are submitted together with reaping of
+// completions by one io_uring_enter() per wakeup.
+//
+// Where the kernel allows it (6.0+), the engine does the I/O itself:
+// listeners are served by multishot accept, and streams by multishot
+// recv into a ring of provided buffers and by sendmsg right from the
+// memory of the output. Other descriptors (and all of them on older kernels)
+// are watched by one-shot polls, re-armed on the next wait, which
+// keeps level-triggered semantics of the other engines.
+class UringEngine : public AEngine {
+
+public:
+    // Send in flight keeps the strings it was given. It's tagged by
+    // its address, so it's found (and freed) even if descriptor is
+    // removed. Iovecs are advanced if it's short.
+    struct SendOp {
+        int                       fd;
+        std::vector<struct iovec> iov;
+        std::size_t               first;
+        struct msghdr             msg;
+        StringsVec                kept;
+        long                      size;
+        long                      sent;
+    };
+
+    struct Slot {
+        uint32_t    events;
+        uint32_t    mask;
+        uint32_t    gen;
+        uint32_t    reg;
+        bool        registered;
+        bool        armed;
+        bool        dirty;
+        bool        listener;
+        bool        receiving;
+        bool        cancelling;
+        bool        ended;
+        SendOp     *sendOp;
+    };
+
+    typedef std::vector<Slot>     SlotsVec;
+    typedef std::vector<int>      FdsVec;
+    typedef std::vector<uint16_t> BufIdsVec;
+
+private:
+    int _ringfd;
+
+    void       *_sqMap;
+    std::size_t _sqMapSize;
+    void       *_cqMap;
+    std::size_t _cqMapSize;
+    void       *_sqesMap;
+    std::size_t _sqesMapSize;
+
+    volatile unsigned *_sqHead;
+    volatile unsigned *_sqTail;
+    unsigned           _sqMask;
+    unsigned           _sqEntries;
+    unsigned          *_sqArray;
+    struct io_uring_sqe *_sqes;
+
+    volatile unsigned *_cqHead;
+    volatile unsigned *_cqTail;
+    unsigned           _cqMask;
+    struct io_uring_cqe *_cqes;
+
+    unsigned _toSubmit;
+
+    bool                  _completes;
+    void                 *_bufRingMap;
+    std::size_t           _bufRingMapSize;
+    void                 *_bufsMap;
+    std::size_t           _bufsMapSize;
+    struct io_uring_buf  *_bufRing;
+    uint16_t              _bufTail;
+    BufIdsVec             _consumed;
+
+    SlotsVec _slots;
+    FdsVec   _dirty;
+
+    struct __kernel_timespec _ts;
+
+public:
+    UringEngine(void);
+    ~UringEngine(void);
+
+    int init(void);
+    int add(int fd, uint32_t events);
+    int mod(int fd, uint32_t events);
+    int del(int fd);
+    int wait(int timeout);
+
+    const char *name(void) const;
+
+    int  listen(int fd);
+    bool completes(void) const;
+    long send(int fd, const struct iovec *iov, int count, StringsVec &kept);
+    std::size_t sending(int fd) const;
+
+private:
+    UringEngine(const UringEngine &);
+    UringEngine &operator=(const UringEngine &);
+
+    int  initBuffers(void);
+    void provide(uint16_t bid);
+    void recycle(void);
+
+    Slot *slot(int fd);
+    struct io_uring_sqe *getSqe(void);
+    int  enter(unsigned toSubmit, unsigned minComplete, unsigned flags);
+    int  submit(void);
+    void touch(int fd);
+    void update(int fd);
+    void arm(int fd, uint32_t mask);
+    void disarm(int fd);
+    void accept(int fd);
+    void receive(int fd);
+    bool startSend(SendOp *);
+    void cancel(uint64_t tag);
+
+    void completePoll(int fd, const struct io_uring_cqe *);
+    void completeAccept(int fd, const struct io_uring_cqe *);
+    void completeRecv(int fd, const struct io_uring_cqe *);
+    void completeSend(SendOp *, const struct io_uring_cqe *);
+    void report(int fd, uint32_t events, int res, const char *data);
+};
+
+#endif
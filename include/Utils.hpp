@@ -82,6 +82,7 @@ bool isExtension(const std::string &ext);
 bool resourceExists(const std::string &filename);
 bool isFile(const std::string &filename);
 bool isDirectory(const std::string &dirname);
+bool isUploadFile(const std::string &filename);
 bool isWritableFile(const std::string &filename);
 bool isReadableFile(const std::string &filename);
 bool isExecutableFile(const std::string &filename);
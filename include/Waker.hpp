@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef __linux__
+    # define WS_EVENTFD
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef WS_EVENTFD
+# include <sys/eventfd.h>
+#endif
+
+#include "Logger.hpp"
+#include "Stats.hpp"
+
+// Lets other threads interrupt waiting of an event loop.
+// It's eventfd on Linux and self-pipe elsewhere; the loop
+// watches fd() for reading and drains it when it's ready.
+// Notifications are coalesced till the loop drains them,
+// so only the first one after draining costs a syscall.
+class Waker {
+
+private:
+    int _rdFd;
+    int _wrFd;
+
+    volatile int _pending;
+
+public:
+    Waker(void);
+    ~Waker(void);
+
+    int  init(void);
+    int  fd(void) const;
+    void notify(void);
+    void drain(void);
+
+private:
+    Waker(const Waker &);
+    Waker &operator=(const Waker &);
+};
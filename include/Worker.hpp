@@ -1,18 +1,50 @@
 #pragma once
 
+#include "CancelToken.hpp"
 #include "Logger.hpp"
 #include "Globals.hpp"
 #include "Response.hpp"
+#include "Stats.hpp"
+#include "Time.hpp"
 #include <pthread.h>
+#include <stdint.h>
 
+#include <deque>
+
+class WorkerPool;
+
+// Every worker has its own queue of responses. Jobs are taken
+// from its front by the worker itself and from its back by
+// idle workers stealing them, each queue has its own lock.
+// Retired worker refuses new jobs till it's started again.
 class Worker {
 
 public:
-    static std::size_t count;
+    // Response waiting for a worker and the time it was queued at.
+    // Token is retained by the job, so the job could be dropped
+    // without looking at the client it came from.
+    struct Job {
+        HTTP::Response *res;
+        CancelToken    *token;
+        uint64_t        queued;
+    };
+
+    typedef std::deque<Job>      JobsDeque;
+    typedef JobsDeque::iterator  iter_jd;
 
 private:
-    int       _id;
-    pthread_t _thread;
+    int         _id;
+    pthread_t   _thread;
+    WorkerPool *_pool;
+
+    JobsDeque       _jobs;
+    pthread_mutex_t _m_jobs;
+    pthread_cond_t  _c_jobs;
+
+    volatile int _sleeping;
+    bool         _woken;
+    bool         _retired;
+    bool         _started;
 
 public:
     Worker(void);
@@ -20,11 +52,28 @@ public:
     ~Worker(void);
 
     Worker &operator=(const Worker &);
+    void init(WorkerPool *, int id);
     int create(void);
     int detach(void);
     int join(void);
     int id(void) const;
+    WorkerPool *pool(void) const;
+    bool started(void) const;
+
+    std::size_t push(const Job &);
+    bool pop(Job &);
+    bool steal(Job &);
+
+    bool sleeping(void) const;
+    void sleeping(bool);
+    void wait(std::time_t usec);
+    void wake(void);
+
+    bool retire(void);
+    void revive(void);
 
 private:
+    bool take(Job &, bool back);
+
     static void *_cycle(void *ptr);
 };
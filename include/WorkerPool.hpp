@@ -0,0 +1,66 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "Logger.hpp"
+#include "Settings.hpp"
+#include "Stats.hpp"
+#include "Worker.hpp"
+
+// Workers serving one class of responses (static files, CGI,
+// proxy or a pool named by locations), so slow handlers of one
+// class can't hold up the others. Slots for max_workers are
+// allocated at once and the first _nbWorkers of them run, the
+// pool grows by queue depth or wait time and shrinks when idle.
+class WorkerPool {
+
+private:
+    std::string _name;
+    Worker     *_workers;
+    std::size_t _minWorkers;
+    std::size_t _maxWorkers;
+    std::size_t _maxQueue;
+
+    volatile std::size_t   _nbWorkers;
+    volatile unsigned long _nextWorker;
+    volatile long          _queued;
+
+    pthread_mutex_t _m_workers;
+
+    volatile long _jobs;
+    volatile long _rejected;
+    volatile long _waitUs;
+    volatile long _waitMaxUs;
+    volatile long _handleUs;
+    volatile long _handleMaxUs;
+
+public:
+    WorkerPool(void);
+    ~WorkerPool(void);
+
+    int  init(const std::string &name, const Settings::WorkerPoolSettings &);
+    void start(void);
+    void stop(void);
+
+    const std::string &name(void) const;
+
+    bool push(HTTP::Response *);
+    bool take(Worker &, Worker::Job &);
+    bool retire(Worker &);
+
+    void dequeued(long waitUs);
+    void handled(long handleUs);
+
+    void print(void);
+
+private:
+    WorkerPool(const WorkerPool &);
+    WorkerPool &operator=(const WorkerPool &);
+
+    std::size_t pick(HTTP::Client *);
+    bool        steal(Worker &, Worker::Job &);
+    void        grow(void);
+};
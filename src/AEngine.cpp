@@ -0,0 +1,98 @@
+#include "AEngine.hpp"
+#include "PollEngine.hpp"
+#include "EpollEngine.hpp"
+#include "UringEngine.hpp"
+
+#include <errno.h>
+
+#ifdef WS_EPOLL
+    # define WS_FALLBACK_ENGINE "epoll"
+#else
+    # define WS_FALLBACK_ENGINE "poll"
+#endif
+
+AEngine::AEngine(void)
+    : _nbReady(0) {}
+
+AEngine::~AEngine(void) {}
+
+std::size_t
+AEngine::ready(void) const {
+    return _nbReady;
+}
+
+const AEngine::Event &
+AEngine::operator[](std::size_t i) const {
+    return _ready[i];
+}
+
+// Readiness-based engines report listeners as readable,
+// and connections are read and written by their owners
+
+int
+AEngine::listen(int fd) {
+    return add(fd, EVENT_IN);
+}
+
+bool
+AEngine::completes(void) const {
+    return false;
+}
+
+long
+AEngine::send(int fd, const struct iovec *iov, int count, StringsVec &kept) {
+    (void)fd;
+    (void)iov;
+    (void)count;
+    (void)kept;
+    errno = ENOTSUP;
+    return -1;
+}
+
+std::size_t
+AEngine::sending(int fd) const {
+    (void)fd;
+    return 0;
+}
+
+AEngine *
+AEngine::create(const std::string &type) {
+
+    AEngine *engine = NULL;
+
+    if (type == "epoll") {
+#ifdef WS_EPOLL
+        engine = new EpollEngine();
+#else
+        Log.error() << "AEngine:: epoll is not supported on this platform, poll is used" << Log.endl;
+        engine = new PollEngine();
+#endif
+    } else if (type == "io_uring") {
+#ifdef WS_URING
+        engine = new UringEngine();
+#else
+        Log.error() << "AEngine:: io_uring is not supported on this platform, poll is used" << Log.endl;
+        engine = new PollEngine();
+#endif
+    } else {
+        engine = new PollEngine();
+    }
+
+    if (engine == NULL) {
+        Log.syserr() << "AEngine:: Cannot allocate memory for engine" << Log.endl;
+        return NULL;
+    }
+
+    if (engine->init() < 0) {
+        delete engine;
+        // io_uring could be disabled by kernel config or seccomp
+        if (type == "io_uring") {
+            Log.error() << "AEngine:: io_uring is not available, " << (WS_FALLBACK_ENGINE) << " is used" << Log.endl;
+            return create(WS_FALLBACK_ENGINE);
+        }
+        return NULL;
+    }
+
+    Log.debug() << "AEngine:: " << engine->name() << " engine is used" << Log.endl;
+    return engine;
+}
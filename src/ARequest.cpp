@@ -19,18 +19,22 @@ ARequest::ARequest(void)
     , _isProxy(false)
     , _isCGI(false)
     , _parted(false)
+    , _upload(false)
     , _status(OK)
     , _fileaddr(NULL)
     , _filefd(-1)
-    , _offset(0) {}
+    , _offset(0)
+    , _outputEnd(0) {}
 
 ARequest::~ARequest(void) {
     if (_filefd != -1) {
         close(_filefd);
     }
+    if (_upload) {
+        unlink(_filename.c_str());
+    }
     if (_fileaddr != NULL) {
-        // Log.debug() << "munmap file" << Log.endl;
-        munmap(_fileaddr, getRealBodySize());
+        munmap(_fileaddr, _filestat.st_size);
     }
 }
 
@@ -82,21 +86,27 @@ ARequest::getFilename(void) const {
 void
 ARequest::setBody(const std::string &body) {
     _body = body;
+    _fileParts.clear();
     setRealBodySize(body.length());
 }
 
+static bool
+writeAll(int fd, const std::string &data) {
+    for (size_t i = 0; i < data.length(); ) {
+        int bytes = write(fd, &data[i], data.length() - i);
+        if (bytes < 0) {
+            Log.syserr() << "ARequest:: Cannot write to tmp file" << Log.endl;
+            return false;
+        }
+        i += bytes;
+    }
+    return true;
+}
+
 void
 ARequest::appendBody(const std::string &body) {
     if (_filefd != -1) {
-        const char *data = body.c_str();
-        for (size_t i = 0; i < body.length(); ) {
-            int bytes = write(_filefd, &data[i], body.length() - i);
-            if (bytes < 0) {
-                Log.syserr() << "ARequest:: Cannot write to tmp file" << Log.endl;
-                return ;
-            }
-            i += bytes;
-        }
+        writeAll(_filefd, body);
     } else {
         _body += body;
     }
@@ -138,6 +148,48 @@ ARequest::parted(bool parted) {
     _parted = parted;
 }
 
+bool
+ARequest::fileBody(void) const {
+    return !_fileParts.empty();
+}
+
+// Body is a segment of the open file, it's sent
+// by the kernel straight from the page cache
+void
+ARequest::setFileBody(uint64_t offset, uint64_t size) {
+    setBody("");
+    addFilePart("", offset, size);
+}
+
+// Frames are small and go as they are, file ranges are
+// never copied. Body size counts both of them.
+void
+ARequest::addFilePart(const std::string &frame, uint64_t offset, uint64_t size) {
+    FilePart part;
+    part.frame = frame;
+    part.offset = offset;
+    part.size = size;
+    _fileParts.push_back(part);
+    setRealBodySize(getRealBodySize() + frame.length() + size);
+}
+
+const ARequest::FileParts &
+ARequest::getFileParts(void) const {
+    return _fileParts;
+}
+
+// Position in the output of the connection where the
+// message ends, it's written once the position is passed
+uint64_t
+ARequest::getOutputEnd(void) const {
+    return _outputEnd;
+}
+
+void
+ARequest::setOutputEnd(uint64_t end) {
+    _outputEnd = end;
+}
+
 bool
 ARequest::sent(void) const {
     return headSent() && bodySent();
@@ -269,8 +321,77 @@ ARequest::createTmpFile(void) {
     return true;
 }
 
+// Upload with known length is written right into a file next to its
+// destination, so it's moved into place by rename() in the end.
+// Space is reserved up front; on failure errno tells the reason.
 bool
-ARequest::mapFile(void) {
+ARequest::createUploadFile(const std::string &dir) {
+
+    std::string path = dir + "/" UPLOAD_FILE_PREFIX "XXXXXX";
+    _filefd = mkstemp(&path[0]);
+    if (_filefd == -1) {
+        int err = errno;
+        Log.debug() << "ARequest:: Unable to create upload file in " << dir << Log.endl;
+        errno = err;
+        return false;
+    }
+    _filename = path;
+    _upload = true;
+    fchmod(_filefd, 0644);
+
+#ifdef __linux__
+    if (getExpBodySize() > 0 && fallocate(_filefd, 0, 0, getExpBodySize()) < 0 && errno != EOPNOTSUPP) {
+        int err = errno;
+        Log.syserr() << "ARequest:: Unable to reserve " << getExpBodySize() << " bytes for upload" << Log.endl;
+        close(_filefd);
+        unlink(_filename.c_str());
+        _filefd = -1;
+        _upload = false;
+        errno = err;
+        return false;
+    }
+#endif
+    return true;
+}
+
+// Called by the response, the file isn't removed afterwards
+bool
+ARequest::moveUploadFile(const std::string &path) {
+
+    if (std::rename(_filename.c_str(), path.c_str())) {
+        Log.syserr() << "Cannot move upload file " << _filename << Log.endl;
+        return false;
+    }
+    _upload = false;
+    return true;
+}
+
+bool
+ARequest::uploading(void) const {
+    return _upload;
+}
+
+// Bytes were written into the upload file by IO
+StatusCode
+ARequest::writeUpload(long bytes) {
+
+    if (bytes < 0) {
+        int err = errno;
+        Log.syserr() << "ARequest:: Cannot write to upload file " << _filename << Log.endl;
+        return (err == ENOSPC ? INSUFFICIENT_STORAGE : INTERNAL_SERVER_ERROR);
+    }
+
+    setRealBodySize(getRealBodySize() + bytes);
+    if (getRealBodySize() == getExpBodySize()) {
+        Log.debug() << "ARequest:: Upload processed" << Log.endl;
+        setFlag(PARSED_BODY);
+        return PROCESSING;
+    }
+    return CONTINUE;
+}
+
+bool
+ARequest::statFile(void) {
 
     if (_filefd < 0) {
         Log.error() << "open failed" <<Log.endl;
@@ -283,16 +404,27 @@ ARequest::mapFile(void) {
     }
 
     setRealBodySize(_filestat.st_size);
+    return true;
+}
+
+bool
+ARequest::mapFile(void) {
+
+    if (!statFile()) {
+        return false;
+    }
 
-    _fileaddr = (char *)mmap(NULL, getRealBodySize(), PROT_READ, MAP_SHARED, _filefd, 0);
-    if (_fileaddr == NULL) {
+    if (_filestat.st_size == 0) {
+        return true;
+    }
+
+    _fileaddr = (char *)mmap(NULL, _filestat.st_size, PROT_READ, MAP_SHARED, _filefd, 0);
+    if (_fileaddr == MAP_FAILED) {
+        _fileaddr = NULL;
         Log.error() << "mmap failed" <<Log.endl;
         return false;   
     }
 
-    std::string res;
-    res.append(_fileaddr, getRealBodySize());
-
     return true;
 }
 
@@ -304,27 +436,31 @@ ARequest::tunnelGuard(bool value) {
     return value;
 }
 
+// Returns frame of the next chunk (with the end of the previous one),
+// its data is the file range of size bytes at offset. The last chunk
+// has no data.
 std::string
-ARequest::makeChunk(void) {
+ARequest::makeChunk(uint64_t &offset, uint64_t &size) {
 
-    std::string res;
+    std::string res = (_offset > 0 ? CRLF : "");
 
     const uint64_t chunk_size = g_server->settings.chunk_size;
     const uint64_t filesize = getRealBodySize();
 
+    offset = _offset;
+    size = 0;
+
     if (_offset >= filesize) {
         // could be trailer headers
-        res = "0" CRLF CRLF;
+        res += "0" CRLF CRLF;
         chunked(false);
 
     } else {
-        uint64_t size = chunk_size;
+        size = chunk_size;
         if (filesize - _offset < chunk_size) {
             size = filesize - _offset;
         }
-
-        res.assign(_fileaddr + _offset, size);
-        res = itohs(size) + CRLF + res + CRLF;
+        res += itohs(size) + CRLF;
 
         _offset += size;
     }
@@ -449,6 +585,12 @@ ARequest::parseBody(const std::string &line) {
             return INTERNAL_SERVER_ERROR;
         }
         Log.debug() << "ARequest:: tmp file " << _filename << " created" << Log.endl; 
+
+        // Body read so far goes first
+        if (!writeAll(_filefd, _body)) {
+            return INTERNAL_SERVER_ERROR;
+        }
+        std::string().swap(_body);
     }
 
     if (chunked()) {
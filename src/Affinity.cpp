@@ -0,0 +1,270 @@
+#include "Affinity.hpp"
+#include "Utils.hpp"
+
+#ifdef WS_AFFINITY
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+#include <errno.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+Affinity::CpusVec Affinity::_reactorCpus;
+Affinity::CpusVec Affinity::_workerCpus;
+
+// List is like "0-3,8,10-11". "auto" and empty string are
+// handled by the caller.
+bool
+Affinity::parse(const std::string &list, CpusVec &cpus) {
+
+    cpus.clear();
+
+    std::size_t pos = 0;
+    while (pos < list.length()) {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.length();
+        }
+        const std::string range = list.substr(pos, end - pos);
+        pos = end + 1;
+
+        const std::size_t dash = range.find('-');
+        const std::string first = range.substr(0, dash);
+        const std::string last = dash == std::string::npos ? first : range.substr(dash + 1);
+        if (first.empty() || last.empty()
+            || first.find_first_not_of("0123456789") != std::string::npos
+            || last.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+
+        const int from = std::atoi(first.c_str());
+        const int to = std::atoi(last.c_str());
+        if (from > to || to >= 4096) {
+            return false;
+        }
+        for (int cpu = from; cpu <= to; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+#ifdef WS_AFFINITY
+
+int
+Affinity::allowed(CpusVec &cpus) {
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) < 0) {
+        Log.syserr() << "Affinity::sched_getaffinity failed" << Log.endl;
+        return -1;
+    }
+
+    cpus.clear();
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return 0;
+}
+
+// Topology id of the CPU, 0 if it's unknown
+int
+Affinity::topology(int cpu, const char *name) {
+
+    std::ifstream file(("/sys/devices/system/cpu/cpu" + itos(cpu) + "/topology/" + name).c_str());
+    int id = 0;
+    if (!(file >> id)) {
+        return 0;
+    }
+    return id;
+}
+
+int
+Affinity::package(int cpu) {
+    return topology(cpu, "physical_package_id");
+}
+
+// True if the CPU is one of the CPUs or their hyperthread siblings
+bool
+Affinity::sharesCore(int cpu, const CpusVec &cpus) {
+
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        if (package(cpu) == package(cpus[i]) && topology(cpu, "core_id") == topology(cpus[i], "core_id")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reactors take one CPU per core, cores of the first package go
+// first. Siblings of taken cores are used only if cores run out.
+void
+Affinity::autoReactors(std::size_t reactors, const CpusVec &allowed) {
+
+    CpusVec order;
+    const int first = package(allowed[0]);
+    for (std::size_t i = 0; i < allowed.size(); ++i) {
+        if (package(allowed[i]) == first) {
+            order.push_back(allowed[i]);
+        }
+    }
+    for (std::size_t i = 0; i < allowed.size(); ++i) {
+        if (package(allowed[i]) != first) {
+            order.push_back(allowed[i]);
+        }
+    }
+
+    for (std::size_t i = 0; i < order.size() && _reactorCpus.size() < reactors; ++i) {
+        if (!sharesCore(order[i], _reactorCpus)) {
+            _reactorCpus.push_back(order[i]);
+        }
+    }
+    for (std::size_t i = 0; i < order.size() && _reactorCpus.size() < reactors; ++i) {
+        if (std::find(_reactorCpus.begin(), _reactorCpus.end(), order[i]) == _reactorCpus.end()) {
+            _reactorCpus.push_back(order[i]);
+        }
+    }
+}
+
+// Workers take the rest of the packages with reactors, except
+// the cores of reactors. If nothing is left, they share them.
+void
+Affinity::autoWorkers(const CpusVec &allowed) {
+
+    std::vector<int> packages;
+    for (std::size_t i = 0; i < _reactorCpus.size(); ++i) {
+        packages.push_back(package(_reactorCpus[i]));
+    }
+
+    CpusVec near;
+    for (std::size_t i = 0; i < allowed.size(); ++i) {
+        if (!packages.empty() && std::find(packages.begin(), packages.end(), package(allowed[i])) == packages.end()) {
+            continue ;
+        }
+        near.push_back(allowed[i]);
+
+        if (!sharesCore(allowed[i], _reactorCpus)) {
+            _workerCpus.push_back(allowed[i]);
+        }
+    }
+    if (_workerCpus.empty()) {
+        _workerCpus = near;
+    }
+}
+
+// Explicit CPUs are filtered by the allowed ones
+int
+Affinity::layout(const std::string &list, const CpusVec &allowed, CpusVec &res) {
+
+    CpusVec cpus;
+    parse(list, cpus);
+
+    res.clear();
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        if (std::binary_search(allowed.begin(), allowed.end(), cpus[i])) {
+            res.push_back(cpus[i]);
+        } else {
+            Log.error() << "Affinity:: CPU " << cpus[i] << " is not allowed, skipped" << Log.endl;
+        }
+    }
+    if (res.empty()) {
+        Log.error() << "Affinity:: none of CPUs " << list << " is allowed" << Log.endl;
+        return -1;
+    }
+    return 0;
+}
+
+int
+Affinity::init(std::size_t reactors, const std::string &reactorCpus, const std::string &workerCpus) {
+
+    _reactorCpus.clear();
+    _workerCpus.clear();
+
+    if (reactorCpus.empty() && workerCpus.empty()) {
+        return 0;
+    }
+
+    CpusVec cpus;
+    if (allowed(cpus) < 0 || cpus.empty()) {
+        return -1;
+    }
+
+    if (reactorCpus == "auto") {
+        autoReactors(reactors, cpus);
+    } else if (!reactorCpus.empty() && layout(reactorCpus, cpus, _reactorCpus) < 0) {
+        return -1;
+    }
+
+    if (workerCpus == "auto") {
+        autoWorkers(cpus);
+    } else if (!workerCpus.empty() && layout(workerCpus, cpus, _workerCpus) < 0) {
+        return -1;
+    }
+
+    Log.info() << "Affinity:: reactors on " << _reactorCpus.size() << " CPUs, workers on "
+               << _workerCpus.size() << " CPUs of " << cpus.size() << " allowed" << Log.endl;
+    return 0;
+}
+
+void
+Affinity::pin(const CpusVec &cpus) {
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        CPU_SET(cpus[i], &set);
+    }
+
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        errno = err;
+        Log.syserr() << "Affinity::pthread_setaffinity_np failed" << Log.endl;
+    }
+}
+
+#else
+
+int
+Affinity::init(std::size_t, const std::string &reactorCpus, const std::string &workerCpus) {
+
+    _reactorCpus.clear();
+    _workerCpus.clear();
+
+    if (!reactorCpus.empty() || !workerCpus.empty()) {
+        Log.error() << "Affinity:: CPU pinning is not supported on this system" << Log.endl;
+    }
+    return 0;
+}
+
+void
+Affinity::pin(const CpusVec &) {}
+
+#endif
+
+// Reactors take CPUs in turn, one each
+void
+Affinity::pinReactor(std::size_t id) {
+
+    if (_reactorCpus.empty()) {
+        return ;
+    }
+    pin(CpusVec(1, _reactorCpus[id % _reactorCpus.size()]));
+}
+
+void
+Affinity::pinWorker(void) {
+
+    if (_workerCpus.empty()) {
+        return ;
+    }
+    pin(_workerCpus);
+}
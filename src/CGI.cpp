@@ -67,11 +67,10 @@ bool CGI::setEnv(Request *req) {
     // PATH_TRANSLATED
     setValue(_env[1], req->getResolvedPath());
 
-    const std::string &host = req->getClient()->getDomainName();
     const std::string &addr = req->getClient()->getClientIO()->getAddr();
 
     // REMOTE_HOST
-    setValue(_env[2], host.empty() ? addr : host);
+    setValue(_env[2], g_server->remoteHost(addr));
 
     // REMOTE_ADDR
     setValue(_env[3], addr);
@@ -226,14 +225,17 @@ CGI::exec(Request *req) {
     close(in.rdFd());
     close(out.wrFd());
 
+    // Output is read till it's drained, which mustn't block the loop
+    io->nonblock();
+
     setPID(childPID);
 
     if (req->getRealBodySize() != 0) {
-        g_server->link(io->wrFd(), client);
+        client->getReactor()->link(io->wrFd(), client);
     } else {
         close(io->wrFd());
     }
-    g_server->link(io->rdFd(), client);
+    client->getReactor()->link(io->rdFd(), client);
     return 1;
 }
 
@@ -56,3 +56,19 @@ crc(const char *buf, std::size_t len) {
     }
     return ~oldcrc32;
 }
+
+// Same as crc() of the lowercased string, without making it
+uint32_t
+crcLower(const char *buf, std::size_t len) {
+    register uint32_t oldcrc32;
+
+    oldcrc32 = 0xFFFFFFFF;
+    for (; len; --len, ++buf) {
+        uint8_t c = static_cast<uint8_t>(*buf);
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        oldcrc32 = crc_table[((oldcrc32) ^ c) & 0xff] ^ ((oldcrc32) >> 8);
+    }
+    return ~oldcrc32;
+}
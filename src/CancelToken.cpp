@@ -0,0 +1,44 @@
+#include "CancelToken.hpp"
+
+CancelToken::CancelToken(void)
+    : _state(0)
+    , _refs(1) {}
+
+CancelToken::~CancelToken(void) {}
+
+void CancelToken::retain(void) {
+    __sync_fetch_and_add(&_refs, 1);
+}
+
+void CancelToken::release(void) {
+    if (__sync_sub_and_fetch(&_refs, 1) == 0) {
+        delete this;
+    }
+}
+
+// Returns false if the token is cancelled
+bool CancelToken::claim(void) {
+
+    long state = _state;
+    while (!(state & 1)) {
+        long prev = __sync_val_compare_and_swap(&_state, state, state + 2);
+        if (prev == state) {
+            return true;
+        }
+        state = prev;
+    }
+    return false;
+}
+
+void CancelToken::unclaim(void) {
+    __sync_fetch_and_sub(&_state, 2);
+}
+
+// Succeeds only if nobody has claimed the token
+bool CancelToken::cancel(void) {
+    return __sync_bool_compare_and_swap(&_state, 0, 1) || (_state & 1);
+}
+
+bool CancelToken::cancelled(void) const {
+    return (_state & 1) != 0;
+}
@@ -0,0 +1,212 @@
+#include "ChainBuffer.hpp"
+#include "SlabPool.hpp"
+
+#include <cstring>
+#include <sys/uio.h>
+
+ChainBuffer::ChainBuffer(void)
+    : _head(NULL)
+    , _tail(NULL)
+    , _size(0) {}
+
+ChainBuffer::~ChainBuffer(void) {
+    while (_head != NULL) {
+        popSlab();
+    }
+}
+
+std::size_t
+ChainBuffer::size(void) const {
+    return _size;
+}
+
+// Memory taken by the slabs, headers and free space included
+std::size_t
+ChainBuffer::held(void) const {
+
+    std::size_t bytes = 0;
+    for (const Slab *slab = _head; slab != NULL; slab = slab->next) {
+        bytes += slab->size;
+    }
+    return bytes;
+}
+
+bool
+ChainBuffer::empty(void) const {
+    return _size == 0;
+}
+
+// Returns free space at the end of the buffer (a new slab is
+// added if the last one is full), or NULL if allocation failed
+char *
+ChainBuffer::tail(std::size_t &avail) {
+
+    if (_tail == NULL || _tail->end == _tail->capacity()) {
+        const std::size_t size = (_head == NULL ? SlabPool::SMALL : SlabPool::LARGE);
+
+        Slab *slab = reinterpret_cast<Slab *>(SlabPool::get(size));
+        if (slab == NULL) {
+            avail = 0;
+            return NULL;
+        }
+        slab->next = NULL;
+        slab->size = size;
+        slab->beg = 0;
+        slab->end = 0;
+
+        if (_tail != NULL) {
+            _tail->next = slab;
+        } else {
+            _head = slab;
+        }
+        _tail = slab;
+    }
+
+    avail = _tail->capacity() - _tail->end;
+    return _tail->data() + _tail->end;
+}
+
+// Makes bytes written into the tail a part of the buffer
+void
+ChainBuffer::commit(std::size_t bytes) {
+    _tail->end += bytes;
+    _size += bytes;
+}
+
+// Returns offset of the first c from the read cursor, or npos
+std::size_t
+ChainBuffer::find(char c) const {
+
+    std::size_t offset = 0;
+    for (Slab *slab = _head; slab != NULL; slab = slab->next) {
+        const char *beg = slab->data() + slab->beg;
+        const char *found = static_cast<const char *>(std::memchr(beg, c, slab->end - slab->beg));
+        if (found != NULL) {
+            return offset + (found - beg);
+        }
+        offset += slab->end - slab->beg;
+    }
+    return npos;
+}
+
+// Contiguous data at the read cursor, the rest is in the next slabs
+const char *
+ChainBuffer::front(std::size_t &len) const {
+
+    if (_head == NULL) {
+        len = 0;
+        return NULL;
+    }
+    len = _head->end - _head->beg;
+    return _head->data() + _head->beg;
+}
+
+// Contiguous data at offset from the read cursor, or NULL
+// if there is no data there yet
+const char *
+ChainBuffer::peek(std::size_t offset, std::size_t &len) const {
+
+    for (Slab *slab = _head; slab != NULL; slab = slab->next) {
+        std::size_t size = slab->end - slab->beg;
+        if (offset < size) {
+            len = size - offset;
+            return slab->data() + slab->beg + offset;
+        }
+        offset -= size;
+    }
+    len = 0;
+    return NULL;
+}
+
+// Copies first bytes into out
+void
+ChainBuffer::copy(std::string &out, std::size_t bytes) const {
+
+    out.clear();
+    out.reserve(bytes);
+
+    std::size_t left = bytes;
+    for (Slab *slab = _head; slab != NULL && left > 0; slab = slab->next) {
+        std::size_t len = slab->end - slab->beg;
+        if (len > left) {
+            len = left;
+        }
+        out.append(slab->data() + slab->beg, len);
+        left -= len;
+    }
+}
+
+// Copies first bytes into out and consumes them
+void
+ChainBuffer::take(std::string &out, std::size_t bytes) {
+    copy(out, bytes);
+    consume(bytes);
+}
+
+// Writes first bytes into fd straight from the slabs and consumes
+// the written ones. Returns number of bytes written, or -1.
+long
+ChainBuffer::writeTo(int fd, std::size_t bytes) {
+
+    static const int IOV_COUNT = 64;
+
+    struct iovec iov[IOV_COUNT];
+    int count = 0;
+
+    std::size_t left = bytes;
+    for (Slab *slab = _head; slab != NULL && left > 0 && count < IOV_COUNT; slab = slab->next) {
+        std::size_t len = slab->end - slab->beg;
+        if (len > left) {
+            len = left;
+        }
+        iov[count].iov_base = slab->data() + slab->beg;
+        iov[count].iov_len = len;
+        ++count;
+        left -= len;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    long written = writev(fd, iov, count);
+    if (written > 0) {
+        consume(written);
+    }
+    return written;
+}
+
+void
+ChainBuffer::consume(std::size_t bytes) {
+
+    if (bytes > _size) {
+        bytes = _size;
+    }
+    _size -= bytes;
+
+    while (_head != NULL) {
+        std::size_t len = _head->end - _head->beg;
+        if (bytes < len) {
+            _head->beg += bytes;
+            return ;
+        }
+        bytes -= len;
+        popSlab();
+    }
+}
+
+void
+ChainBuffer::clear(void) {
+    consume(_size);
+}
+
+void
+ChainBuffer::popSlab(void) {
+
+    Slab *slab = _head;
+    _head = slab->next;
+    if (_head == NULL) {
+        _tail = NULL;
+    }
+    SlabPool::put(reinterpret_cast<char *>(slab), slab->size);
+}
@@ -2,38 +2,53 @@
 
 #include "Server.hpp"
 
+#ifdef __linux__
+# include <malloc.h>
+#endif
+
 namespace HTTP {
 
+// Streamed bodies are made by pieces only while
+// the output of the connection is shorter
+static const std::size_t OUTPUT_LIMIT = 256 * 1024;
+
 Client::Client(void)
-    : _clientIO(NULL), 
-    _serverIO(NULL),
-    _gatewayIO(NULL),
-    _processing(false),
+    : _serverIO(NULL),
+    _reactor(NULL),
+    _token(NULL),
     _shouldBeClosed(false),
     _shouldBeRemoved(false),
     _isTunnel(false),
+    _connecting(false),
+    _tunnel(NULL),
     _nbRequests(0),
     _maxRequests(g_server->settings.max_requests),
     _clientTimeout(0),
     _gatewayTimeout(0),
+    _clientTimer(CLIENT_TIMER, this),
+    _gatewayTimer(GATEWAY_TIMER, this),
     _id(-1),
+    _idle(false),
+    _idleBytes(0),
     links(0) 
 {
-    _clientIO = new IO();
-    if (_clientIO == NULL) {
-        Log.syserr() << "Client:: Cannot allocate memory for client socket" << Log.endl;
+    _token = new CancelToken();
+    if (_token == NULL) {
+        Log.syserr() << "Client:: Cannot allocate memory for cancel token" << Log.endl;
     }
 
-    _gatewayIO = new IO();
-    if (_gatewayIO == NULL) {
-        Log.syserr() << "Client:: Cannot allocate memory for gateway socket" << Log.endl;
-    }
+    Stats::inc(STAT_CONNECTIONS);
 }
 
 Client::~Client(void) {
     typedef std::list<Request *>  PoolReq;
     typedef std::list<Response *> PoolRes;
 
+    if (_reactor != NULL) {
+        _reactor->schedule(&_clientTimer, 0);
+        _reactor->schedule(&_gatewayTimer, 0);
+    }
+
     for (PoolReq::iterator it = _requests.begin(); it != _requests.end(); ++it) {
         if (*it != NULL) {
             delete *it;
@@ -46,21 +61,59 @@ Client::~Client(void) {
         }
     }
 
-    if (_gatewayIO) {
-        delete _gatewayIO;
+    if (_tunnel) {
+        delete _tunnel;
+    }
+
+    // Jobs still queued keep the token and are dropped by workers
+    if (_token) {
+        _token->cancel();
+        _token->release();
     }
 
-    if (_clientIO) {
-        delete _clientIO;
+    Stats::add(STAT_CONNECTIONS, -1);
+    if (_idle) {
+        Stats::addLocal(STAT_IDLE_CONNECTIONS, -1);
+        Stats::addLocal(STAT_IDLE_CONNECTION_BYTES, -_idleBytes);
     }
 }
 
-void Client::processing(bool flag) {
-    _processing = flag;
+static long
+heapSize(const void *ptr, std::size_t size) {
+#ifdef __linux__
+    (void)size;
+    return ptr != NULL ? malloc_usable_size(const_cast<void *>(ptr)) : 0;
+#else
+    return ptr != NULL ? size : 0;
+#endif
 }
 
-bool Client::processing(void) const {
-    return _processing;
+// Heap taken by the connection: its objects as the allocator
+// sees them and the slabs of its input buffers
+long Client::footprint(void) const {
+    return heapSize(this, sizeof(Client)) + heapSize(_token, sizeof(CancelToken))
+        + _clientIO.getRem().held() + _gatewayIO.getRem().held();
+}
+
+// Connection is idle while it waits for the next request with
+// nothing buffered. Its footprint is taken when it goes idle.
+void Client::checkIdle(void) {
+
+    const bool idle = _tunnel == NULL && _requests.empty() && _responses.empty()
+        && _clientIO.rdFd() >= 0 && _clientIO.getRem().empty() && !_clientIO.pending();
+    if (idle == _idle) {
+        return ;
+    }
+
+    if (idle) {
+        _idleBytes = footprint();
+        Stats::incLocal(STAT_IDLE_CONNECTIONS);
+        Stats::addLocal(STAT_IDLE_CONNECTION_BYTES, _idleBytes);
+    } else {
+        Stats::addLocal(STAT_IDLE_CONNECTIONS, -1);
+        Stats::addLocal(STAT_IDLE_CONNECTION_BYTES, -_idleBytes);
+    }
+    _idle = idle;
 }
 
 void Client::shouldBeClosed(bool flag) {
@@ -79,6 +132,10 @@ void Client::isTunnel(bool value) {
     _isTunnel = value;
 }
 
+bool Client::relaying(void) const {
+    return _tunnel != NULL;
+}
+
 time_t
 Client::getClientTimeout(void) const {
     return _clientTimeout;
@@ -89,16 +146,20 @@ Client::getGatewayTimeout(void) const {
     return _gatewayTimeout;
 }
 
+// Timeouts are reset by the event loop only, so are its timers.
+// Zero time cancels the timer.
 void Client::setClientTimeout(time_t time) {
     _clientTimeout = time;
+    getReactor()->schedule(&_clientTimer, time != 0 ? time + g_server->settings.max_client_timeout + 1 : 0);
 }
 
 void Client::setGatewayTimeout(time_t time) {
     _gatewayTimeout = time;
+    getReactor()->schedule(&_gatewayTimer, time != 0 ? time + g_server->settings.max_gateway_timeout + 1 : 0);
 }
 
 IO *Client::getClientIO(void) {
-    return _clientIO;
+    return &_clientIO;
 }
 
 IO *Client::getServerIO(void) {
@@ -106,29 +167,23 @@ IO *Client::getServerIO(void) {
 }
 
 IO *Client::getGatewayIO(void) {
-    return _gatewayIO;
-}
-
-void Client::setClientIO(IO *sock) {
-    _clientIO = sock;
+    return &_gatewayIO;
 }
 
 void Client::setServerIO(IO *sock) {
     _serverIO = sock;
 }
 
-void Client::setGatewayIO(IO *sock) {
-    _gatewayIO = sock;
+Reactor *Client::getReactor(void) {
+    return _reactor;
 }
 
-const std::string &
-Client::getDomainName(void) const {
-    return _domain;
+void Client::setReactor(Reactor *reactor) {
+    _reactor = reactor;
 }
 
-void
-Client::setDomainName(const std::string &name) {
-    _domain = name;
+CancelToken *Client::getCancelToken(void) {
+    return _token;
 }
 
 const std::string
@@ -177,7 +232,16 @@ void Client::addResponse(void) {
     }
     _responses.push_back(res);
 
-    g_server->addToRespQ(_responses.back());
+    StatsCounter counter;
+    if (res->isInline(counter)) {
+        Stats::inc(counter);
+        res->handle();
+        getReactor()->armWrite(getClientIO()->wrFd());
+    } else if (!g_server->addToRespQ(res)) {
+        res->setStatus(SERVICE_UNAVAILABLE);
+        res->handle();
+        getReactor()->armWrite(getClientIO()->wrFd());
+    }
 
     Log.debug() << "Client::addResponse " << res->getRequest()->getUriRef()._path << Log.endl;
 }
@@ -194,54 +258,127 @@ void Client::removeResponse(void) {
     if (_responses.size() > 0) {
         Response *res = _responses.front();
         _responses.pop_front();
-        processing(false);
         delete res;
     }
 }
 
+// Ready responses are queued into the output of the connection in
+// order, so heads, bodies and the following pipelined responses leave
+// together. Writes as long as socket accepts data, it's required by
+// edge-triggered mode as no more events are reported until the socket
+// buffer is filled.
 void Client::tryReplyResponse(int fd) {
+    signal(SIGPIPE, SIG_IGN);
 
-    if (_responses.empty()) {
-        return ;
-    }
+    IO *io = getClientIO();
 
-    HTTP::Response *res = _responses.front();
-    if (res->formed() && !res->sent()) {
-        reply(res);
-    }
+    for (;;) {
+        typedef std::list<Response *>::iterator iter_res;
 
-    if (res->formed() && res->sent()) {
+        for (iter_res it = _responses.begin(); it != _responses.end() && (*it)->formed(); ++it) {
+            if (!queueOutput(*it, io, false)) {
+                break ;
+            }
+        }
+
+        while (!_responses.empty() && _responses.front()->sent()
+            && io->written() >= _responses.front()->getOutputEnd()) {
+            removeRequest();
+            removeResponse();
+        }
+
+        // Data taken by the engine is sent before the socket is closed
+        // or given to the tunnel
+        if (shouldBeClosed() && _responses.empty() && !io->pending()) {
+            getReactor()->unlink(fd);
+            io->reset();
+            return ;
+        }
 
-        removeRequest();
-        removeResponse();
+        if (_connecting && _responses.empty() && !io->pending()) {
+            _connecting = false;
+            if (isTunnel()) {
+                startTunnel();
+                return ;
+            }
+            getReactor()->armWrite(fd);
+            takeRequests();
+        }
 
-        if (shouldBeClosed()) {
-            g_server->unlink(fd);
-            getClientIO()->reset();
+        if (!io->pending()) {
+            break ;
         }
+
+        int bytes = io->write();
+        if (bytes < 0) {
+            break ;
+        }
+
+        if (bytes == 0) {
+            getReactor()->unlink(io->wrFd());
+            io->reset();
+
+            getReactor()->unlink(getGatewayIO()->rdFd());
+            getReactor()->unlink(getGatewayIO()->wrFd());
+            getGatewayIO()->reset();
+            return ;
+        }
+    }
+
+    if (!hasPendingOutput(fd)) {
+        getReactor()->disarmWrite(fd);
     }
+    checkIdle();
 }
 
 void Client::tryReplyRequest(int fd) {
+    signal(SIGPIPE, SIG_IGN);
 
     if (_requests.empty()) {
         return ;
     }
 
     HTTP::Request *req = _requests.front();
-    if (req->formed() && !req->sent()) {
-        reply(req);
+    IO            *io = getGatewayIO();
+
+    while (req->formed()) {
+        queueOutput(req, io, true);
+        if (!io->pending()) {
+            break ;
+        }
+
+        int bytes = io->write();
+        if (bytes < 0) {
+            if (req->isCGI()) {
+                Log.syserr() << "Client:: [" << io->wrFd() << " write failed" << Log.endl;
+                getReactor()->unlink(io->wrFd());
+                io->reset();
+            }
+            break ;
+        }
+
+        if (bytes == 0) {
+            Log.debug() << "Client:: [" << io->wrFd() << "] peer closed connection" << Log.endl;
+            getReactor()->unlink(io->wrFd());
+            io->reset();
+            return ;
+        }
     }
 
-    if (req->formed() && req->sent()) {
+    if (req->formed() && req->sent() && !io->pending()) {
         setGatewayTimeout(Time::now());
 
         if (req->isCGI()) {
             Log.debug() << "Client:: request sent" << Log.endl; 
-            g_server->unlink(fd);
+            getReactor()->unlink(fd);
             getGatewayIO()->wrFd(-1);
+            return ;
         }
     }
+
+    if (!hasPendingOutput(fd)) {
+        getReactor()->disarmWrite(fd);
+    }
 }
 
 void Client::tryReceiveResponse(int fd) {
@@ -257,60 +394,148 @@ void Client::tryReceiveResponse(int fd) {
 
     if (res->formed()) {
         if (!isTunnel()) {
-            g_server->unlink(fd);
+            getReactor()->unlink(fd);
             getGatewayIO()->reset();
         }
+        getReactor()->armWrite(getClientIO()->wrFd());
     }
 }
 
 void Client::tryReceiveRequest(int fd) {
     (void)fd;
 
-    if (shouldBeClosed()) {
-        return ;
+    if (!shouldBeClosed() && !_connecting && receive()) {
+        takeRequests();
+
+        // Peer has closed after the data, it won't be reported again
+        if (getClientIO()->eof() && !shouldBeClosed() && !_connecting) {
+            receive();
+        }
     }
+    checkIdle();
+}
+
+// Every complete request already read is taken, so pipelined
+// requests don't wait for more data to come from the socket.
+// Nothing after CONNECT is parsed, it's the tunnel's data.
+void Client::takeRequests(void) {
+
+    while (!shouldBeClosed()) {
+        if (_requests.size() == _responses.size()) {
+            addRequest();
+        }
 
-    if (_requests.size() == _responses.size()) {
-        addRequest();
+        Request *req = _requests.back();
+        parse(req);
+        if (!req->formed()) {
+            break ;
+        }
+
+        // Rest of the input can't be trusted after an invalid request.
+        // It's set here, not by the response, which could be handled
+        // by a worker while the loop goes on parsing
+        if (req->getStatus() >= BAD_REQUEST) {
+            shouldBeClosed(true);
+        }
+        addResponse();
+
+        if (req->getMethod() == "CONNECT") {
+            _connecting = true;
+            getReactor()->armWrite(getClientIO()->rdFd());
+            break ;
+        }
+
+        if (getClientIO()->getRem().empty()) {
+            break ;
+        }
     }
+}
+
+// Reading waits while CONNECT is being handled, then
+// the tunnel decides on it. Requests aren't read anymore
+// from a connection which is going to be closed.
+bool
+Client::wantsInput(int fd) {
 
-    if (_requests.size() > _responses.size()) {
-        receive(_requests.back());
+    if (_tunnel != NULL) {
+        return _tunnel->wantsInput(fd);
     }
+    if (fd == getClientIO()->rdFd() && shouldBeClosed()) {
+        return false;
+    }
+    return !_connecting;
+}
 
-    if (_requests.back()->formed()) {
-        addResponse();
+// Output is pending while there are unwritten bytes
+// or the first formed message isn't queued yet
+bool
+Client::hasPendingOutput(int fd) {
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (_tunnel != NULL) {
+        return _tunnel->wantsOutput(fd);
     }
+
+    if (fd == getClientIO()->wrFd()) {
+        if (getClientIO()->pending()) {
+            return true;
+        }
+        typedef std::list<Response *>::iterator iter_res;
+        for (iter_res it = _responses.begin(); it != _responses.end() && (*it)->formed(); ++it) {
+            if (!(*it)->sent()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Gateway of CONNECT gets nothing before the tunnel is set up
+    if (fd == getGatewayIO()->wrFd()) {
+        return !_connecting && (getGatewayIO()->pending() ||
+            (!_requests.empty() && _requests.front()->formed() && !_requests.front()->sent()));
+    }
+
+    return false;
 }
 
+// Called by the event loop when timer of the kind has expired
 void
-Client::checkTimeout(void) {
+Client::timeoutExpired(int kind) {
+
+    if (_tunnel != NULL) {
+        if (kind == CLIENT_TIMER) {
+            Log.debug() << "Client:: [" << getClientIO()->rdFd() << "] tunnel timeout exceeded" << Log.endl;
+            closeTunnel();
+        }
+        return ;
+    }
 
-    std::time_t current = Time::now();
+    if (kind == CLIENT_TIMER) {
 
-    if (getClientTimeout() != 0 && current - getClientTimeout() > g_server->settings.max_client_timeout) {
-        
         IO *io = getClientIO();
 
         if (io->rdFd() >= 0) {
             Log.debug() << "Client:: [" << io->rdFd() << "] client timeout exceeded" << Log.endl;
             
-            g_server->unlink(io->rdFd());
+            getReactor()->unlink(io->rdFd());
             io->reset();
             setClientTimeout(0);
         }
         // 408 Request Timeout
     }
 
-    if (getGatewayTimeout() != 0 && current - getGatewayTimeout() > g_server->settings.max_gateway_timeout) {
+    if (kind == GATEWAY_TIMER) {
 
         IO *io = getGatewayIO();
     
         if (io->rdFd() >= 0) {
             Log.debug() << "Client:: [" << io->rdFd() << "] gateway timeout exceeded" << Log.endl;
             
-            g_server->unlink(io->rdFd());
-            g_server->unlink(io->wrFd());
+            getReactor()->unlink(io->rdFd());
+            getReactor()->unlink(io->wrFd());
             setGatewayTimeout(0);
             io->reset();
             
@@ -325,151 +550,116 @@ Client::checkTimeout(void) {
     }
 }
 
-void Client::reply(Response *res) {
-    signal(SIGPIPE, SIG_IGN);
+// Puts pieces of the message into the output while it's short. Head
+// and bodies are referenced (or copied if the message could be removed
+// before they are written), file bodies and chunks go as file ranges
+// after their frames, and only parts are made one by one. Returns true
+// if the message is queued completely.
+bool Client::queueOutput(ARequest *msg, IO *io, bool copy) {
 
-    IO *io = getClientIO();
-
-    if (!res->headSent()) {
-        if (res->getHead().empty()) {
-            res->headSent(true);
-            return ;
-        }
+    if (msg->sent()) {
+        return true;
+    }
 
-        if (!io->getDataPos()) {
-            io->setData(res->getHead());
+    if (!msg->headSent()) {
+        if (copy) {
+            std::string head = msg->getHead();
+            io->take(head);
+        } else {
+            io->queue(msg->getHead().data(), msg->getHead().length());
         }
+        msg->headSent(true);
+    }
 
-    } else if (!res->bodySent()) {
+    while (!msg->bodySent() && io->pending() < OUTPUT_LIMIT) {
 
-        if (res->chunked()) {
-            if (!io->getDataPos()) {
-                io->setData(res->makeChunk());
-            }
-        } else if (res->parted()) {
-            if (!io->getDataPos()) {
-                io->setData(res->makePart());
+        if (msg->chunked()) {
+            uint64_t offset;
+            uint64_t size;
+            std::string frame = msg->makeChunk(offset, size);
+            io->take(frame);
+            if (size > 0) {
+                io->queue(msg->getFileFd(), offset, size);
             }
+        } else if (msg->parted()) {
+            std::string part = msg->makePart();
+            io->take(part);
         } else {
-            if (!io->getDataPos()) {
-                io->setData(res->getBody());
+            if (msg->fileBody()) {
+                queueFileParts(msg, io, copy);
+            } else if (copy) {
+                std::string body = msg->getBody();
+                io->take(body);
+            } else {
+                io->queue(msg->getBody().data(), msg->getBody().length());
             }
+            msg->bodySent(true);
         }
-
-        if (io->getData().empty()) {
-            res->bodySent(true);
-            return ;
-        }
-    }
-
-    int bytes = io->write();
-    
-    if (bytes < 0) {
-        return ;
-    }
-    
-    if (bytes == 0) {
-        g_server->unlink(io->wrFd());
-        io->reset();
-
-        g_server->unlink(getGatewayIO()->rdFd());
-        g_server->unlink(getGatewayIO()->wrFd());
-        getGatewayIO()->reset();
-        return ;
     }
 
-    if (static_cast<std::size_t>(bytes) >= io->getDataSize()) {
-        if (!res->headSent()) {
-            res->headSent(true);
-
-        } else if (!res->bodySent() && !res->chunked() && !res->parted()) {
-            res->bodySent(true);
-        }
+    if (msg->sent()) {
+        msg->setOutputEnd(io->queued());
     }
+    return msg->sent();
 }
 
-void Client::reply(Request *req) {
+void Client::queueFileParts(ARequest *msg, IO *io, bool copy) {
 
-    signal(SIGPIPE, SIG_IGN);
-
-    IO *io = getGatewayIO();
-
-    if (!req->headSent()) {
-        if (req->getHead().empty()) {
-            req->headSent(true);
-            return ;
+    const ARequest::FileParts &parts = msg->getFileParts();
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        if (copy) {
+            std::string frame = parts[i].frame;
+            io->take(frame);
+        } else if (!parts[i].frame.empty()) {
+            io->queue(parts[i].frame.data(), parts[i].frame.length());
         }
-
-        if (!io->getDataPos()) {
-            io->setData(req->getHead());
-        }
-
-    } else if (!req->bodySent()) {
-
-        if (req->chunked()) {
-            if (!io->getDataPos()) {
-                io->setData(req->makeChunk());
-            }
-        } else if (req->parted()) {
-            if (!io->getDataPos()) {
-                io->setData(req->makePart());
-            }
-        } else {
-            if (!io->getDataPos()) {
-                io->setData(req->getBody());
-            }
-        }
-
-        if (io->getData().empty()) {
-            req->bodySent(true);
-            return ;
-        }
-    }
-
-    int bytes = io->write();
-    
-    if (bytes < 0) {
-        if (req->isCGI()) {
-            Log.syserr() << "Client:: [" << io->wrFd() << " write failed" << Log.endl;
-            g_server->unlink(io->wrFd());
-            io->reset();
-        }
-        return ;
-    }
-    
-    if (bytes == 0) {
-        Log.debug() << "Client:: [" << io->wrFd() << "] peer closed connection" << Log.endl;
-        g_server->unlink(io->wrFd());
-        io->reset();
-        return ;
-    }
-
-    if (static_cast<std::size_t>(bytes) >= io->getDataSize()) {
-        if (!req->headSent()) {
-            req->headSent(true);
-        } else if (!req->bodySent() && !req->chunked() && !req->parted()) {
-            req->bodySent(true);
+        if (parts[i].size > 0) {
+            io->queue(msg->getFileFd(), parts[i].offset, parts[i].size);
         }
     }
 }
 
-void Client::receive(Request *req) {
+// Returns false if nothing was read
+bool Client::receive(void) {
 
     int bytes = getClientIO()->read();
 
     if (bytes < 0) {
-        return ;
+        return false;
 
     } else if (bytes == 0) {
         Log.debug() << "Client::receive [" << getClientIO()->rdFd() << "] peer closed connection" << Log.endl;
-        g_server->unlink(getClientIO()->rdFd());
+        getReactor()->unlink(getClientIO()->rdFd());
         getClientIO()->reset();
-        return ;
+        return false;
     }
 
     setClientTimeout(Time::now());
+    return true;
+}
+
+void Client::parse(Request *req) {
 
     while (!req->formed()) {
+
+        if (!req->flagSet(PARSED_HEADERS)) {
+            std::size_t len = req->parseHead(getClientIO()->getRem());
+            if (len == 0) {
+                return ;
+            }
+            getClientIO()->discard(len);
+            continue ;
+        }
+
+        // Upload goes from the input slabs right into its file
+        if (req->uploading()) {
+            if (getClientIO()->getRem().empty()) {
+                return ;
+            }
+            req->parseUpload(getClientIO()->spill(req->getFileFd(), req->getExpBodySize() - req->getRealBodySize()));
+            continue ;
+        }
+
         std::string line;
 
         if (!getClientIO()->getline(line, req->getExpBodySize() - req->getRealBodySize())) {
@@ -485,17 +675,21 @@ void Client::receive(Response *res) {
     int bytes = getGatewayIO()->read();
 
     if (bytes < 0) {
-        if (res->isCGI()) {
+        if (res->isCGI() && errno != EAGAIN) {
             Log.debug() << "Client::receive CGI failed" << Log.endl;
             res->checkCGIFailure();
 
-            g_server->unlink(getGatewayIO()->rdFd());
+            getReactor()->unlink(getGatewayIO()->rdFd());
             getGatewayIO()->reset();
             setGatewayTimeout(0);
         }
         return ;
+    }
 
-    } else if (bytes == 0) {
+    // End of the stream could come along with the last data
+    const bool done = (bytes == 0 || getGatewayIO()->eof());
+
+    if (done) {
         Log.debug() << "Client::receive [" << getGatewayIO()->rdFd() << "] resp done" << Log.endl;
 
         if (res->isCGI()) {
@@ -504,7 +698,7 @@ void Client::receive(Response *res) {
             Log.debug() << "Rem len: " << res->getExpBodySize() << Log.endl;
         }
 
-        g_server->unlink(getGatewayIO()->rdFd());
+        getReactor()->unlink(getGatewayIO()->rdFd());
     }
 
     setGatewayTimeout(0);
@@ -517,13 +711,120 @@ void Client::receive(Response *res) {
         }
 
         if (!getGatewayIO()->getline(line, res->getExpBodySize() - res->getRealBodySize())) {
-            return ;
+            // CGI response without Content-Length ends with EOF,
+            // so the rest of data is taken as is (and then empty
+            // lines finish headers and body)
+            if (!done || !res->isCGI()) {
+                return ;
+            }
+            getGatewayIO()->getline(line, getGatewayIO()->getRem().size());
         }
 
         res->parseLine(line);
     }
 }
 
+// Response to CONNECT is written, the rest of the connection
+// is relayed to the gateway as is
+void Client::startTunnel(void) {
+
+    IO *io = getClientIO();
+
+    std::string early;
+    if (!io->getRem().empty()) {
+        io->getline(early, io->getRem().size());
+    }
+
+    _tunnel = new Tunnel();
+    if (_tunnel == NULL || _tunnel->init(io->rdFd(), getGatewayIO()->rdFd(), early) < 0) {
+        Log.error() << "Client:: [" << io->rdFd() << "] cannot set up tunnel" << Log.endl;
+        closeTunnel();
+        return ;
+    }
+
+    Log.debug() << "Client:: [" << io->rdFd() << "] tunnel to [" << getGatewayIO()->rdFd() << "]" << Log.endl;
+    Stats::inc(STAT_TUNNELS);
+    setGatewayTimeout(0);
+
+    // Socket isn't streamed by the engine anymore
+    getReactor()->armWrite(io->rdFd());
+    relay();
+}
+
+void Client::tryRelay(int fd) {
+    (void)fd;
+    relay();
+}
+
+// Interest of both sockets is changed only if
+// relaying has changed what the tunnel waits for
+void Client::relay(void) {
+
+    const int fds[2] = { getClientIO()->rdFd(), getGatewayIO()->rdFd() };
+
+    bool in[2];
+    bool out[2];
+    for (int i = 0; i < 2; ++i) {
+        in[i] = _tunnel->wantsInput(fds[i]);
+        out[i] = _tunnel->wantsOutput(fds[i]);
+    }
+
+    long moved = _tunnel->relay();
+    if (moved < 0 || _tunnel->finished()) {
+        closeTunnel();
+        return ;
+    }
+
+    if (moved > 0) {
+        Stats::add(STAT_TUNNEL_BYTES, moved);
+        setClientTimeout(Time::now());
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (fds[i] >= 0 && (in[i] != _tunnel->wantsInput(fds[i]) || out[i] != _tunnel->wantsOutput(fds[i]))) {
+            getReactor()->armWrite(fds[i]);
+        }
+    }
+}
+
+// Socket is removed right away, as hangup would be reported
+// again and again, the other one is served till it's drained
+void Client::hangup(int fd) {
+
+    relay();
+    if (_tunnel == NULL) {
+        return ;
+    }
+
+    _tunnel->hangup(fd);
+    getReactor()->unlink(fd);
+    if (fd == getClientIO()->rdFd()) {
+        getClientIO()->reset();
+    } else {
+        getGatewayIO()->reset();
+    }
+
+    relay();
+}
+
+void Client::closeTunnel(void) {
+
+    if (getClientIO()->rdFd() >= 0) {
+        getReactor()->unlink(getClientIO()->rdFd());
+        getClientIO()->reset();
+    }
+    if (getGatewayIO()->rdFd() >= 0) {
+        getReactor()->unlink(getGatewayIO()->rdFd());
+        getGatewayIO()->reset();
+    }
+    setClientTimeout(0);
+
+    if (_tunnel != NULL) {
+        delete _tunnel;
+        _tunnel = NULL;
+    }
+}
+
 ServerBlock *
 Client::matchServerBlock(const std::string &host) {
 
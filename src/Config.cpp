@@ -283,16 +283,23 @@ const char * validKeywords[] = {
     KW_METHODS_ALLOWED, KW_POST_MAX_BODY, KW_REDIRECT, KW_AUTH_BASIC,
     KW_SETTINGS, KW_MAX_WAIT_CONN, KW_WORKERS, KW_WORKER_TIMEOUT, KW_MAX_REQUESTS,
     KW_MAX_CLIENT_TIMEOUT, KW_MAX_GATEWAY_TIMEOUT, KW_MAX_URI_LENGTH, 
-    KW_MAX_HEADER_FIELD_LENGTH, KW_BLIND_PROXY, KW_SESSION_LIFETIME, KW_CHUNK_SIZE,
+    KW_MAX_HEADER_FIELD_LENGTH, KW_MAX_HEADER_FIELDS, KW_BLIND_PROXY, KW_SESSION_LIFETIME, KW_CHUNK_SIZE,
     KW_MAX_REG_FILE_SIZE, KW_MAX_RANGE_SIZE, KW_COOKIE_HTTP_ONLY, KW_MAX_REG_UPLOAD_SIZE,
-    KW_CGI_METHODS, NULL
+    KW_CGI_METHODS, KW_EVENT_ENGINE, KW_EDGE_TRIGGERED, KW_REACTORS, KW_ACCEPT_BUDGET,
+    KW_REVERSE_DNS, KW_REVERSE_DNS_TTL, KW_WORKER_DISTRIBUTION, KW_MAX_WORKERS,
+    KW_WORKER_GROW_WAIT, KW_WORKER_GROW_DEPTH, KW_WORKER_IDLE_TIMEOUT, KW_WORKER_POOLS,
+    KW_WORKER_POOL, KW_MAX_QUEUE, KW_REACTOR_CPUS, KW_WORKER_CPUS, NULL
 };
 
 const char * validSettingsKeywords[] = {
     KW_SETTINGS, KW_MAX_WAIT_CONN, KW_WORKERS, KW_WORKER_TIMEOUT, KW_MAX_REQUESTS,
     KW_MAX_CLIENT_TIMEOUT, KW_MAX_GATEWAY_TIMEOUT, KW_MAX_URI_LENGTH, 
-    KW_MAX_HEADER_FIELD_LENGTH, KW_BLIND_PROXY, KW_SESSION_LIFETIME, KW_CHUNK_SIZE,
-    KW_MAX_REG_FILE_SIZE, KW_MAX_RANGE_SIZE, KW_COOKIE_HTTP_ONLY, KW_MAX_REG_UPLOAD_SIZE, NULL
+    KW_MAX_HEADER_FIELD_LENGTH, KW_MAX_HEADER_FIELDS, KW_BLIND_PROXY, KW_SESSION_LIFETIME, KW_CHUNK_SIZE,
+    KW_MAX_REG_FILE_SIZE, KW_MAX_RANGE_SIZE, KW_COOKIE_HTTP_ONLY, KW_MAX_REG_UPLOAD_SIZE,
+    KW_EVENT_ENGINE, KW_EDGE_TRIGGERED, KW_REACTORS, KW_ACCEPT_BUDGET,
+    KW_REVERSE_DNS, KW_REVERSE_DNS_TTL, KW_WORKER_DISTRIBUTION, KW_MAX_WORKERS,
+    KW_WORKER_GROW_WAIT, KW_WORKER_GROW_DEPTH, KW_WORKER_IDLE_TIMEOUT, KW_WORKER_POOLS,
+    KW_REACTOR_CPUS, KW_WORKER_CPUS, NULL
 };
 
 const char * validServerBlockKeywords[] = {
@@ -303,7 +310,7 @@ const char * validServerBlockKeywords[] = {
 const char * validLocationKeywords[] = {
     KW_CGI, KW_ROOT, KW_ALIAS, KW_INDEX, KW_AUTOINDEX, KW_ERROR_PAGES, KW_PROXY_PASS,
     KW_METHODS_ALLOWED, KW_POST_MAX_BODY, KW_REDIRECT, KW_AUTH_BASIC, KW_ADD_HEADERS,
-    KW_CGI_METHODS, NULL
+    KW_CGI_METHODS, KW_WORKER_POOL, NULL
 };
 
 const char * validRedirectKeywords[] = {
@@ -314,6 +321,10 @@ const char * validAuthBasicKeywords[] = {
     KW_REALM, KW_USER_FILE, NULL
 };
 
+const char * validWorkerPoolKeywords[] = {
+    KW_WORKERS, KW_MAX_WORKERS, KW_MAX_QUEUE, NULL
+};
+
 const char * validGlobalKeywords[] = {
     KW_SERVERS, KW_SETTINGS, NULL
 };
@@ -790,6 +801,11 @@ parseLocation(Object *src, Location &dst, Location &def) {
         return NONE_OR_INV;
     }
 
+    if (!getString(src, KW_WORKER_POOL, dst.getWorkerPoolRef(), def.getWorkerPoolRef())) {
+        conftrace_add(KW_WORKER_POOL);
+        return NONE_OR_INV;
+    }
+
     return SET;
 }
 
@@ -976,11 +992,144 @@ int parseSize(std::string &s, uint64_t &size) {
 
 }
 
+// Pools for static files, CGI and proxy exist even if they
+// aren't configured: the first one has workers and max_workers,
+// the others start with one worker
+void
+setDefaultWorkerPools(Settings &sets) {
+
+    if (sets.max_workers == 0) {
+        sets.max_workers = sets.workers;
+    }
+
+    Settings::WorkerPoolSettings pool;
+    pool.workers = sets.workers;
+    pool.max_workers = sets.max_workers;
+    pool.max_queue = 0;
+
+    sets.worker_pools.clear();
+    sets.worker_pools[WORKER_POOL_STATIC] = pool;
+    pool.workers = 1;
+    sets.worker_pools[WORKER_POOL_CGI] = pool;
+    sets.worker_pools[WORKER_POOL_PROXY] = pool;
+}
+
+int
+parseWorkerPool(Object *src, Settings::WorkerPoolSettings &dst, Settings::WorkerPoolSettings &def) {
+
+    if (!isValidKeywords(src, validWorkerPoolKeywords)) {
+        return NONE_OR_INV;
+    }
+
+    if (!getUInteger(src, KW_WORKERS, dst.workers, def.workers)) {
+        conftrace_add(KW_WORKERS);
+        return NONE_OR_INV;
+    } else if (dst.workers < 1 || dst.workers > 256) {
+        conftrace_add(KW_WORKERS);
+        Log.error() << KW_WORKERS << " bound is [1; 256]" << Log.endl;
+        return NONE_OR_INV;
+    }
+
+    if (!getUInteger(src, KW_MAX_WORKERS, dst.max_workers, std::max(def.max_workers, dst.workers))) {
+        conftrace_add(KW_MAX_WORKERS);
+        return NONE_OR_INV;
+    } else if (dst.max_workers < dst.workers || dst.max_workers > 256) {
+        conftrace_add(KW_MAX_WORKERS);
+        Log.error() << KW_MAX_WORKERS << " bound is [" << KW_WORKERS << "; 256]" << Log.endl;
+        return NONE_OR_INV;
+    }
+
+    if (!getUInteger(src, KW_MAX_QUEUE, dst.max_queue, def.max_queue)) {
+        conftrace_add(KW_MAX_QUEUE);
+        return NONE_OR_INV;
+    }
+    return SET;
+}
+
+int
+parseWorkerPools(Object *src, Settings &sets) {
+
+    setDefaultWorkerPools(sets);
+
+    Settings::WorkerPoolsMap def = sets.worker_pools;
+    ConfStatus status = basicCheck(src, KW_WORKER_POOLS, OBJECT, sets.worker_pools, def);
+    if (status != SET) {
+        return status;
+    }
+
+    Object *obj = src->get(KW_WORKER_POOLS)->toObj();
+
+    for (Object::iterator it = obj->begin(); it != obj->end(); ++it) {
+        if (!basicCheck(obj, it->first, OBJECT)) {
+            conftrace_add(it->first);
+            return NONE_OR_INV;
+        }
+
+        Settings::WorkerPoolSettings base = def[WORKER_POOL_CGI];
+        if (def.find(it->first) != def.end()) {
+            base = def[it->first];
+        }
+
+        if (!parseWorkerPool(it->second->toObj(), sets.worker_pools[it->first], base)) {
+            conftrace_add(it->first);
+            return NONE_OR_INV;
+        }
+    }
+    return SET;
+}
+
+// CPUs are given as "auto" or a list like "0-3,8"
+int
+parseCpus(Object *src, const std::string &key, std::string &res, const std::string &def) {
+
+    if (!getString(src, key, res, def)) {
+        return NONE_OR_INV;
+    }
+
+    Affinity::CpusVec cpus;
+    if (!res.empty() && res != "auto" && !Affinity::parse(res, cpus)) {
+        Log.error() << key << " should be \"auto\" or a list of CPUs like \"0-3,8\"" << Log.endl;
+        return NONE_OR_INV;
+    }
+    return SET;
+}
+
+// Pools named by locations should be configured
+int
+isValidWorkerPools(Server *serv) {
+
+    Server::ServersMap &servers = serv->getServerBlocks();
+
+    for (Server::iter_sm it = servers.begin(); it != servers.end(); ++it) {
+        for (Server::iter_sl sb = it->second.begin(); sb != it->second.end(); ++sb) {
+
+            std::vector<HTTP::Location *> locations;
+            locations.push_back(&sb->getLocationBaseRef());
+            ServerBlock::LocationsMap &map = sb->getLocationsRef();
+            for (ServerBlock::LocationsMap::iterator loc = map.begin(); loc != map.end(); ++loc) {
+                locations.push_back(&loc->second);
+            }
+
+            for (std::size_t i = 0; i < locations.size(); ++i) {
+                const std::string &pool = locations[i]->getWorkerPoolRef();
+                if (!pool.empty() && serv->settings.worker_pools.count(pool) == 0) {
+                    Log.error() << KW_WORKER_POOL << " " << pool << " is not in " << KW_WORKER_POOLS << Log.endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 int parseSettings(Object *src, Settings &sets) {
 
     Settings def;
 
     ConfStatus status = basicCheck(src, KW_SETTINGS, OBJECT, sets, def);
+    if (status == DEFAULT) {
+        setDefaultWorkerPools(sets);
+    }
     if (status != SET) {
         return status;
     }
@@ -996,12 +1145,73 @@ int parseSettings(Object *src, Settings &sets) {
         return NONE_OR_INV;
     }
 
+    if (!getUInteger(obj, KW_ACCEPT_BUDGET, sets.accept_budget, def.accept_budget)) {
+        conftrace_add(KW_ACCEPT_BUDGET);
+        return NONE_OR_INV;
+    } else if (sets.accept_budget < 1) {
+        conftrace_add(KW_ACCEPT_BUDGET);
+        Log.error() << KW_ACCEPT_BUDGET << " should be greater than 0" << Log.endl;
+        return NONE_OR_INV;
+    }
+
+    if (!getString(obj, KW_EVENT_ENGINE, sets.event_engine, def.event_engine)) {
+        conftrace_add(KW_EVENT_ENGINE);
+        return NONE_OR_INV;
+    } else if (sets.event_engine != "poll" && sets.event_engine != "epoll" && sets.event_engine != "io_uring") {
+        conftrace_add(KW_EVENT_ENGINE);
+        Log.error() << KW_EVENT_ENGINE << " should be one of: poll, epoll, io_uring" << Log.endl;
+        return NONE_OR_INV;
+    }
+
+    if (!getBoolean(obj, KW_EDGE_TRIGGERED, sets.edge_triggered, def.edge_triggered)) {
+        conftrace_add(KW_EDGE_TRIGGERED);
+        return NONE_OR_INV;
+    }
+
+    if (!getUInteger(obj, KW_REACTORS, sets.reactors, def.reactors)) {
+        conftrace_add(KW_REACTORS);
+        return NONE_OR_INV;
+    } else if (sets.reactors < 1 || sets.reactors > 64) {
+        conftrace_add(KW_REACTORS);
+        Log.error() << KW_REACTORS << " bound is [1; 64]" << Log.endl;
+        return NONE_OR_INV;
+    }
+
     if (!getUInteger(obj, KW_WORKERS, sets.workers, def.workers)) {
         conftrace_add(KW_WORKERS);
         return NONE_OR_INV;
-    } else if (sets.workers < 1 || sets.workers > 20) {
+    } else if (sets.workers < 1 || sets.workers > 256) {
         conftrace_add(KW_WORKERS);
-        Log.error() << KW_WORKERS << " bound is [1; 20]" << Log.endl;
+        Log.error() << KW_WORKERS << " bound is [1; 256]" << Log.endl;
+        return NONE_OR_INV;
+    }
+
+    if (!getUInteger(obj, KW_MAX_WORKERS, sets.max_workers, def.max_workers)) {
+        conftrace_add(KW_MAX_WORKERS);
+        return NONE_OR_INV;
+    } else if (sets.max_workers == 0) {
+        sets.max_workers = sets.workers;
+    } else if (sets.max_workers < sets.workers || sets.max_workers > 256) {
+        conftrace_add(KW_MAX_WORKERS);
+        Log.error() << KW_MAX_WORKERS << " bound is [" << KW_WORKERS << "; 256]" << Log.endl;
+        return NONE_OR_INV;
+    }
+
+    if (!getUInteger(obj, KW_WORKER_GROW_DEPTH, sets.worker_grow_depth, def.worker_grow_depth)) {
+        conftrace_add(KW_WORKER_GROW_DEPTH);
+        return NONE_OR_INV;
+    } else if (sets.worker_grow_depth < 1) {
+        conftrace_add(KW_WORKER_GROW_DEPTH);
+        Log.error() << KW_WORKER_GROW_DEPTH << " should be positive" << Log.endl;
+        return NONE_OR_INV;
+    }
+
+    if (!getString(obj, KW_WORKER_DISTRIBUTION, sets.worker_distribution, def.worker_distribution)) {
+        conftrace_add(KW_WORKER_DISTRIBUTION);
+        return NONE_OR_INV;
+    } else if (sets.worker_distribution != "round_robin" && sets.worker_distribution != "affinity") {
+        conftrace_add(KW_WORKER_DISTRIBUTION);
+        Log.error() << KW_WORKER_DISTRIBUTION << " should be one of: round_robin, affinity" << Log.endl;
         return NONE_OR_INV;
     }
 
@@ -1013,6 +1223,37 @@ int parseSettings(Object *src, Settings &sets) {
         sets.worker_timeout = static_cast<time_t>(time);
     }
 
+    time = 0;
+    if (!getUInteger(obj, KW_WORKER_GROW_WAIT, time, def.worker_grow_wait)) {
+        conftrace_add(KW_WORKER_GROW_WAIT);
+        return NONE_OR_INV;
+    } else {
+        sets.worker_grow_wait = static_cast<time_t>(time);
+    }
+
+    time = 0;
+    if (!getUInteger(obj, KW_WORKER_IDLE_TIMEOUT, time, def.worker_idle_timeout)) {
+        conftrace_add(KW_WORKER_IDLE_TIMEOUT);
+        return NONE_OR_INV;
+    } else {
+        sets.worker_idle_timeout = static_cast<time_t>(time);
+    }
+
+    if (!parseWorkerPools(obj, sets)) {
+        conftrace_add(KW_WORKER_POOLS);
+        return NONE_OR_INV;
+    }
+
+    if (!parseCpus(obj, KW_REACTOR_CPUS, sets.reactor_cpus, def.reactor_cpus)) {
+        conftrace_add(KW_REACTOR_CPUS);
+        return NONE_OR_INV;
+    }
+
+    if (!parseCpus(obj, KW_WORKER_CPUS, sets.worker_cpus, def.worker_cpus)) {
+        conftrace_add(KW_WORKER_CPUS);
+        return NONE_OR_INV;
+    }
+
     time = 0;
     if (!getUInteger(obj, KW_MAX_CLIENT_TIMEOUT, time, def.max_client_timeout)) {
         conftrace_add(KW_MAX_CLIENT_TIMEOUT);
@@ -1029,6 +1270,19 @@ int parseSettings(Object *src, Settings &sets) {
         sets.max_gateway_timeout = static_cast<time_t>(time);
     }
 
+    if (!getBoolean(obj, KW_REVERSE_DNS, sets.reverse_dns, def.reverse_dns)) {
+        conftrace_add(KW_REVERSE_DNS);
+        return NONE_OR_INV;
+    }
+
+    time = 0;
+    if (!getUInteger(obj, KW_REVERSE_DNS_TTL, time, def.reverse_dns_ttl)) {
+        conftrace_add(KW_REVERSE_DNS_TTL);
+        return NONE_OR_INV;
+    } else {
+        sets.reverse_dns_ttl = static_cast<time_t>(time);
+    }
+
     time = 0;
     if (!getUInteger(obj, KW_SESSION_LIFETIME, time, def.session_lifetime)) {
         conftrace_add(KW_SESSION_LIFETIME);
@@ -1052,6 +1306,11 @@ int parseSettings(Object *src, Settings &sets) {
         return NONE_OR_INV;
     }
 
+    if (!getUInteger(obj, KW_MAX_HEADER_FIELDS, sets.max_header_fields, def.max_header_fields)) {
+        conftrace_add(KW_MAX_HEADER_FIELDS);
+        return NONE_OR_INV;
+    }
+
     if (!getBoolean(obj, KW_BLIND_PROXY, sets.blind_proxy, def.blind_proxy)) {
         conftrace_add(KW_BLIND_PROXY);
         return NONE_OR_INV;
@@ -1168,6 +1427,13 @@ parseConfig(Object *src, Server *serv) {
         return NONE_OR_INV;
     }
 
+    if (!isValidWorkerPools(serv)) {
+        conftrace_add(KW_SERVERS);
+        conftrace_add("conf");
+        Log.error() << "at " << conftrace_path() << Log.endl;
+        return NONE_OR_INV;
+    }
+
     return SET;
 }
 
@@ -0,0 +1,145 @@
+#include "EpollEngine.hpp"
+
+#ifdef WS_EPOLL
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+static const std::size_t minEvents = 64;
+static const std::size_t maxEvents = 4096;
+
+static uint32_t
+toEpoll(uint32_t events) {
+    uint32_t res = 0;
+    if (events & EVENT_IN) {
+        res |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (events & EVENT_OUT) {
+        res |= EPOLLOUT;
+    }
+    if (events & EVENT_EDGE) {
+        res |= EPOLLET;
+    }
+    return res;
+}
+
+static uint32_t
+fromEpoll(uint32_t revents) {
+    uint32_t res = EVENT_NONE;
+    if (revents & (EPOLLIN | EPOLLRDHUP)) {
+        res |= EVENT_IN;
+    }
+    if (revents & EPOLLOUT) {
+        res |= EVENT_OUT;
+    }
+    if (revents & EPOLLHUP) {
+        res |= EVENT_HUP;
+    }
+    if (revents & EPOLLERR) {
+        res |= EVENT_ERR;
+    }
+    return res;
+}
+
+EpollEngine::EpollEngine(void)
+    : _epfd(-1)
+    , _registered(0) {}
+
+EpollEngine::~EpollEngine(void) {
+    if (_epfd != -1) {
+        close(_epfd);
+    }
+}
+
+const char *
+EpollEngine::name(void) const {
+    return "epoll";
+}
+
+int
+EpollEngine::init(void) {
+
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epfd < 0) {
+        Log.syserr() << "EpollEngine::epoll_create1 failed" << Log.endl;
+        return -1;
+    }
+
+    _events.resize(minEvents);
+    return 0;
+}
+
+int
+EpollEngine::add(int fd, uint32_t events) {
+
+    struct epoll_event ev;
+    ev.events = toEpoll(events);
+    ev.data.u64 = 0;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        Log.syserr() << "EpollEngine::add [" << fd << "]" << Log.endl;
+        return -1;
+    }
+    _registered++;
+    return 0;
+}
+
+// In edge-triggered mode re-applying the same mask makes kernel to
+// report the current readiness once again.
+int
+EpollEngine::mod(int fd, uint32_t events) {
+
+    struct epoll_event ev;
+    ev.events = toEpoll(events);
+    ev.data.u64 = 0;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        Log.debug() << "EpollEngine::mod [" << fd << "] failed" << Log.endl;
+        return -1;
+    }
+    return 0;
+}
+
+int
+EpollEngine::del(int fd) {
+
+    if (epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, NULL) < 0) {
+        Log.debug() << "EpollEngine::del [" << fd << "] failed" << Log.endl;
+        return -1;
+    }
+    _registered--;
+    return 0;
+}
+
+int
+EpollEngine::wait(int timeout) {
+
+    _nbReady = 0;
+
+    if (_events.size() < _registered && _events.size() < maxEvents) {
+        _events.resize(std::min(_registered, maxEvents));
+    }
+
+    int res = epoll_wait(_epfd, _events.data(), _events.size(), timeout);
+    if (res <= 0) {
+        return res;
+    }
+
+    if (_ready.size() < static_cast<std::size_t>(res)) {
+        _ready.resize(res);
+    }
+
+    for (int i = 0; i < res; ++i) {
+        _ready[i].fd = _events[i].data.fd;
+        _ready[i].events = fromEpoll(_events[i].events);
+    }
+    _nbReady = res;
+
+    return res;
+}
+
+#endif
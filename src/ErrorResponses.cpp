@@ -40,6 +40,9 @@ ErrorResponses::ErrorResponses() {
     _errorResponses.insert(std::make_pair(HTTP::UNSUPPORTED_MEDIA_TYPE,
         HTML_BEG HEAD_BEG TITLE_BEG + statusLines[UNSUPPORTED_MEDIA_TYPE] + TITLE_END HEAD_END
         BODY_BEG H1_CENTER_BEG B_BEG + statusLines[UNSUPPORTED_MEDIA_TYPE] + B_END H1_CENTER_END HR BODY_END HTML_END));
+    _errorResponses.insert(std::make_pair(HTTP::REQUEST_HEADER_FIELDS_TOO_LARGE,
+        HTML_BEG HEAD_BEG TITLE_BEG + statusLines[REQUEST_HEADER_FIELDS_TOO_LARGE] + TITLE_END HEAD_END
+        BODY_BEG H1_CENTER_BEG B_BEG + statusLines[REQUEST_HEADER_FIELDS_TOO_LARGE] + B_END H1_CENTER_END HR BODY_END HTML_END));
     _errorResponses.insert(std::make_pair(HTTP::INTERNAL_SERVER_ERROR,
         HTML_BEG HEAD_BEG TITLE_BEG + statusLines[INTERNAL_SERVER_ERROR] + TITLE_END HEAD_END
         BODY_BEG H1_CENTER_BEG B_BEG + statusLines[INTERNAL_SERVER_ERROR] + B_END H1_CENTER_END HR BODY_END HTML_END));
@@ -49,12 +52,18 @@ ErrorResponses::ErrorResponses() {
     _errorResponses.insert(std::make_pair(HTTP::BAD_GATEWAY,
         HTML_BEG HEAD_BEG TITLE_BEG + statusLines[BAD_GATEWAY] + TITLE_END HEAD_END
         BODY_BEG H1_CENTER_BEG B_BEG + statusLines[BAD_GATEWAY] + B_END H1_CENTER_END HR BODY_END HTML_END));
+    _errorResponses.insert(std::make_pair(HTTP::SERVICE_UNAVAILABLE,
+        HTML_BEG HEAD_BEG TITLE_BEG + statusLines[SERVICE_UNAVAILABLE] + TITLE_END HEAD_END
+        BODY_BEG H1_CENTER_BEG B_BEG + statusLines[SERVICE_UNAVAILABLE] + B_END H1_CENTER_END HR BODY_END HTML_END));
     _errorResponses.insert(std::make_pair(HTTP::GATEWAY_TIMEOUT,
         HTML_BEG HEAD_BEG TITLE_BEG + statusLines[GATEWAY_TIMEOUT] + TITLE_END HEAD_END
         BODY_BEG H1_CENTER_BEG B_BEG + statusLines[GATEWAY_TIMEOUT] + B_END H1_CENTER_END HR BODY_END HTML_END));
     _errorResponses.insert(std::make_pair(HTTP::HTTP_VERSION_NOT_SUPPORTED,
         HTML_BEG HEAD_BEG TITLE_BEG + statusLines[HTTP_VERSION_NOT_SUPPORTED] + TITLE_END HEAD_END
         BODY_BEG H1_CENTER_BEG B_BEG + statusLines[HTTP_VERSION_NOT_SUPPORTED] + B_END H1_CENTER_END HR BODY_END HTML_END));
+    _errorResponses.insert(std::make_pair(HTTP::INSUFFICIENT_STORAGE,
+        HTML_BEG HEAD_BEG TITLE_BEG + statusLines[INSUFFICIENT_STORAGE] + TITLE_END HEAD_END
+        BODY_BEG H1_CENTER_BEG B_BEG + statusLines[INSUFFICIENT_STORAGE] + B_END H1_CENTER_END HR BODY_END HTML_END));
     _errorResponses.insert(std::make_pair(HTTP::UNKNOWN_ERROR,
         HTML_BEG HEAD_BEG TITLE_BEG + statusLines[UNKNOWN_ERROR] + TITLE_END HEAD_END
         BODY_BEG H1_CENTER_BEG B_BEG + statusLines[UNKNOWN_ERROR] + B_END H1_CENTER_END HR BODY_END HTML_END));
@@ -30,6 +30,14 @@ Header::parse(const std::string &line, bool trimKey) {
     return true;
 }
 
+// Field is already split and trimmed by the parser. The name
+// isn't kept, the header is known by its hash (as everywhere).
+void
+Header::parse(const char *name, std::size_t nameLen, const char *value, std::size_t valueLen) {
+    this->value.assign(value, valueLen);
+    hash = crcLower(name, nameLen);
+}
+
 std::string
 Header::toString(void) {
     return headerNames[hash] + ": " + value;
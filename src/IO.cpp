@@ -1,15 +1,33 @@
 #include "IO.hpp"
 #include "Server.hpp"
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
+
 static const std::size_t BUFFER_SIZE = 65536;
+static const std::size_t READ_LIMIT = 262144;
+static const int         IOV_COUNT = 64;
 
 IO::IO(void) 
     : _fdr(-1)
     , _fdw(-1)
     , _af(AF_UNSPEC)
     , _port(0)
-    , _dataSize(0)
-    , _dataPos(0) {}
+    , _outPos(0)
+    , _pending(0)
+    , _queued(0)
+    , _written(0)
+    , _full(false)
+    , _eof(false)
+    , _engine(NULL)
+    , _delivered(0) {}
 
 IO::~IO(void) {
 
@@ -25,9 +43,11 @@ IO::wrFd(void) const {
     return _fdw;
 }
 
+// End of the stream belongs to the previous descriptor
 void
 IO::rdFd(int fd) {
     _fdr = fd;
+    eof(false);
 }
 
 void
@@ -55,47 +75,116 @@ IO::getAddr(void) const {
     return _addr;
 }
 
-const std::string &
+bool
+IO::full(void) const {
+    return _full;
+}
+
+void
+IO::full(bool flag) {
+    _full = flag;
+}
+
+bool
+IO::eof(void) const {
+    return _eof;
+}
+
+void
+IO::eof(bool flag) {
+    _eof = flag;
+}
+
+// Stream is received and sent by the engine, read() and
+// write() only take what it has delivered and give it data
+void
+IO::engine(AEngine *engine) {
+    _engine = engine;
+    _delivered = 0;
+}
+
+const ChainBuffer &
 IO::getRem(void) const {
     return _rem;
 }
 
+// Memory should stay valid until written
 void
-IO::setData(const std::string &data) {
-    _data = data;
-    setDataSize(data.length());
+IO::queue(const char *addr, std::size_t size) {
+
+    if (size == 0) {
+        return ;
+    }
+    _out.push_back(Segment());
+    _out.back().addr = addr;
+    _out.back().fd = -1;
+    _out.back().offset = 0;
+    _out.back().size = size;
+    _pending += size;
+    _queued += size;
 }
 
+// Descriptor stays owned by the caller
 void
-IO::setDataSize(std::size_t size) {
-    _dataSize = size;
+IO::queue(int fd, off_t offset, std::size_t size) {
+
+    if (size == 0) {
+        return ;
+    }
+    _out.push_back(Segment());
+    _out.back().addr = NULL;
+    _out.back().fd = fd;
+    _out.back().offset = offset;
+    _out.back().size = size;
+    _pending += size;
+    _queued += size;
 }
 
+// Content of the string is moved into the queue
 void
-IO::setDataPos(std::size_t pos) {
-    _dataPos = pos;
-}
+IO::take(std::string &data) {
 
-const std::string &
-IO::getData(void) const {
-    return _data;
+    if (data.empty()) {
+        return ;
+    }
+    _out.push_back(Segment());
+    _out.back().data.swap(data);
+    _out.back().addr = NULL;
+    _out.back().fd = -1;
+    _out.back().offset = 0;
+    _out.back().size = _out.back().data.length();
+    _pending += _out.back().size;
+    _queued += _out.back().size;
 }
 
+// Data given to the engine stays queued till it's sent
 std::size_t
-IO::getDataSize(void) const {
-    return _dataSize;
+IO::pending(void) const {
+    return _pending;
 }
 
 std::size_t
-IO::getDataPos(void) const {
-    return _dataPos;
+IO::backlog(void) const {
+    return _engine != NULL ? _engine->sending(_fdw) : 0;
+}
+
+// Totals since the descriptor was set up, so a message
+// is written once written() reaches queued() taken after it
+uint64_t
+IO::queued(void) const {
+    return _queued;
+}
+
+uint64_t
+IO::written(void) const {
+    return _written;
 }
 
 void
 IO::clear(void) {
-    _data = "";
-    setDataPos(0);
-    setDataSize(0);
+    _out.clear();
+    _outPos = 0;
+    _pending = 0;
 }
 
 void
@@ -106,7 +195,11 @@ IO::reset(void) {
     setAddr("");
     setPort(0);
     clear();
-    _rem = "";
+    _queued = 0;
+    _written = 0;
+    full(false);
+    engine(NULL);
+    _rem.clear();
 }
 
 int
@@ -159,6 +252,31 @@ IO::nonblock(void) {
     return 0;
 }
 
+// Returns non-blocking close-on-exec descriptor of accepted
+// connection, or -1 (errno is EAGAIN when backlog is drained)
+int
+IO::accept(struct sockaddr_in &addr) {
+
+    socklen_t len = sizeof(addr);
+
+#ifdef __linux__
+    return ::accept4(_fdr, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int fd = ::accept(_fdr, (struct sockaddr *)&addr, &len);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+        Log.syserr() << "IO::fcntl failed for accepted [" << fd << "]" << Log.endl;
+        close(fd);
+        errno = ECONNABORTED;
+        return -1;
+    }
+    return fd;
+#endif
+}
+
 int
 IO::listen(const std::string &addr, std::size_t port) {
 
@@ -174,6 +292,11 @@ IO::listen(const std::string &addr, std::size_t port) {
         Log.syserr() << "IO::setsockopt [" << _fdr << "] ->" << _addr << ":" << _port << Log.endl;
         return -1;
     }
+    // Every reactor listens on its own socket for the same address
+    if (g_server->settings.reactors > 1 && ::setsockopt(_fdr, SOL_SOCKET, SO_REUSEPORT, &i, sizeof(int)) < 0) {
+        Log.syserr() << "IO::setsockopt(SO_REUSEPORT) [" << _fdr << "] ->" << _addr << ":" << _port << Log.endl;
+        return -1;
+    }
     if (::bind(_fdr, (struct sockaddr *)&data, sizeof(data)) < 0) {
         Log.syserr() << "IO::bind [" << _fdr << "] ->" << _addr << ":" << _port << Log.endl;
         return -1;
@@ -187,63 +310,300 @@ IO::listen(const std::string &addr, std::size_t port) {
     return _fdr;
 }
 
+// Data received by the engine goes to the input buffer,
+// empty data is the end of the stream
+int
+IO::deliver(const char *data, std::size_t size) {
+
+    if (size == 0) {
+        eof(true);
+        return 0;
+    }
+
+    while (size > 0) {
+        std::size_t avail = 0;
+        char *buf = _rem.tail(avail);
+        if (buf == NULL) {
+            Log.syserr() << "IO::deliver [" << _fdr << "] cannot allocate buffer" << Log.endl;
+            return -1;
+        }
+
+        std::size_t bytes = std::min(avail, size);
+        std::memcpy(buf, data, bytes);
+        _rem.commit(bytes);
+        _delivered += bytes;
+        data += bytes;
+        size -= bytes;
+    }
+    return 0;
+}
+
+// Reads straight into the input buffer until the socket is drained
+// (short read) or READ_LIMIT is reached, then more could be available.
+// End of the stream met after some data is kept: in edge-triggered
+// mode it isn't reported again, so the caller checks eof().
 int IO::read(void) {
 
-    char buf[BUFFER_SIZE + 1] = { 0 };
+    std::size_t total = 0;
+    full(false);
 
-    int bytes = ::read(_fdr, buf, BUFFER_SIZE);
- 
-    if (bytes > 0) {
-        buf[bytes] = '\0';
-        // telnet: ctrl c, ctrl z
-        if (!strcmp(buf, "\xff\xf4\xff\xfd\x06") || !strcmp(buf, "\xff\xed\xff\xfd\x06")) {
-            return 0;
+    if (eof()) {
+        return 0;
+    }
+
+    if (_engine != NULL) {
+        if (_delivered == 0) {
+            errno = EAGAIN;
+            return -1;
         }
-        
-        _rem.append(buf, bytes);
-        return bytes;
-    } 
+        total = _delivered;
+        _delivered = 0;
+        return total;
+    }
 
-    return bytes;
+    while (total < READ_LIMIT) {
+        std::size_t avail = 0;
+        char *buf = _rem.tail(avail);
+        if (buf == NULL) {
+            Log.syserr() << "IO::read [" << _fdr << "] cannot allocate buffer" << Log.endl;
+            return -1;
+        }
+
+        int bytes = ::read(_fdr, buf, avail);
+        if (bytes == 0) {
+            eof(total > 0);
+            return total;
+        }
+        if (bytes < 0) {
+            return total > 0 ? total : bytes;
+        }
+
+        _rem.commit(bytes);
+        total += bytes;
+
+        if (static_cast<std::size_t>(bytes) < avail) {
+            return total;
+        }
+    }
+
+    full(true);
+    return total;
 }
 
+// Memory segments at the front of the queue leave with one writev(),
+// a file range with sendfile(). If the file range follows them, the
+// socket is told more data is coming, so the head of the response and
+// the beginning of its file body could go in one TCP segment.
+// Stream of an engine gives memory segments to it instead.
 int
 IO::write(void) {
 
-    long bytes = ::write(_fdw,  _data.c_str() + _dataPos, _dataSize - _dataPos);
-    
+    // Nothing is written till the engine has sent its data
+    if (backlog() > 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (_out.empty()) {
+        return 0;
+    }
+
+    long bytes = 0;
+    if (_out.front().fd != -1) {
+        bytes = writeFile(_out.front());
+    } else if (_engine != NULL) {
+        return submit();
+    } else {
+        struct iovec iov[IOV_COUNT];
+
+        int count = 0;
+        std::size_t skip = _outPos;
+        SegmentsQueue::const_iterator it = _out.begin();
+        for (; it != _out.end() && it->fd == -1 && count < IOV_COUNT; ++it, ++count) {
+            const char *addr = it->addr != NULL ? it->addr : it->data.c_str();
+            iov[count].iov_base = const_cast<char *>(addr + skip);
+            iov[count].iov_len = it->size - skip;
+            skip = 0;
+        }
+
+#ifdef MSG_MORE
+        if (it != _out.end() && it->fd != -1) {
+            struct msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            bytes = ::sendmsg(_fdw, &msg, MSG_MORE);
+        } else {
+            bytes = ::writev(_fdw, iov, count);
+        }
+#else
+        bytes = ::writev(_fdw, iov, count);
+#endif
+    }
+
     if (bytes > 0) {
-        _dataPos += bytes;
-    
-        if (_dataPos >= _dataSize) {
-            Log.debug() << "IO::write [" << _fdw << "]: " << _dataPos << "/" << _dataSize << " bytes" << Log.endl;
-            clear();
+        consume(bytes);
+        if (_out.empty()) {
+            Log.debug() << "IO::write [" << _fdw << "]: " << _written << " bytes" << Log.endl;
         }
     }
 
     return bytes;
 }
 
+// Memory segments at the front of the queue are given to the
+// engine at once, they stay queued till the send is reported.
+// Owned data is moved to the send, so it's freed only after the
+// kernel is done with it, even if the output is cleared before.
+long
+IO::submit(void) {
+
+    struct iovec        iov[IOV_COUNT];
+    AEngine::StringsVec kept;
+
+    int count = 0;
+    SegmentsQueue::iterator it = _out.begin();
+    for (; it != _out.end() && it->fd == -1 && count < IOV_COUNT; ++it, ++count) {
+        if (it->addr == NULL) {
+            kept.push_back(std::string());
+        }
+    }
+
+    // Kept strings aren't moved anymore, so their memory is referenced
+    std::size_t k = 0;
+    std::size_t skip = _outPos;
+    it = _out.begin();
+    for (int i = 0; i < count; ++it, ++i) {
+        if (it->addr == NULL) {
+            kept[k].swap(it->data);
+            it->addr = kept[k++].data();
+        }
+        iov[i].iov_base = const_cast<char *>(it->addr + skip);
+        iov[i].iov_len = it->size - skip;
+        skip = 0;
+    }
+
+    long bytes = _engine->send(_fdw, iov, count, kept);
+    if (bytes >= 0) {
+        return bytes;
+    }
+
+    // Nothing is taken, owned data goes back
+    k = 0;
+    it = _out.begin();
+    for (int i = 0; i < count && k < kept.size(); ++it, ++i) {
+        if (it->addr == kept[k].data()) {
+            it->data.swap(kept[k++]);
+            it->addr = NULL;
+        }
+    }
+    return -1;
+}
+
+// Send of the engine is over, the output it was given has left
+void
+IO::sent(std::size_t bytes) {
+
+    if (_engine == NULL || bytes > _pending) {
+        return ;
+    }
+    consume(bytes);
+    if (_out.empty()) {
+        Log.debug() << "IO::write [" << _fdw << "]: " << _written << " bytes" << Log.endl;
+    }
+}
+
+void
+IO::consume(std::size_t bytes) {
+
+    _pending -= bytes;
+    _written += bytes;
+
+    while (bytes > 0) {
+        std::size_t left = _out.front().size - _outPos;
+        if (bytes < left) {
+            _outPos += bytes;
+            return ;
+        }
+        bytes -= left;
+        _outPos = 0;
+        _out.pop_front();
+    }
+}
+
+// File range goes to the socket without being copied to
+// userspace, systems without sendfile() read it by pieces
+int
+IO::writeFile(const Segment &seg) {
+
+    off_t offset = seg.offset + _outPos;
+
+#ifdef __linux__
+    return ::sendfile(_fdw, seg.fd, &offset, seg.size - _outPos);
+#else
+    char buf[BUFFER_SIZE];
+
+    std::size_t size = std::min(seg.size - _outPos, BUFFER_SIZE);
+    long bytes = ::pread(seg.fd, buf, size, offset);
+    if (bytes <= 0) {
+        return bytes;
+    }
+    return ::write(_fdw, buf, bytes);
+#endif
+}
+
 int
 IO::getline(std::string &line, int64_t size) {
     std::size_t pos = 0;
     if (size < 0) {
-        pos = _rem.find(LF);
-        if (pos == std::string::npos) {
+        pos = _rem.find(LF[0]);
+        if (pos == ChainBuffer::npos) {
             return 0;
         }
         pos += 1;
 
     } else {
-        if (_rem.length() == 0 && size != 0) {
+        if (_rem.empty() && size != 0) {
             return 0;
         }
         pos = size;
-        if (pos > _rem.length()) {
-            pos = _rem.length();
+        if (pos > _rem.size()) {
+            pos = _rem.size();
         }
     }
-    line = _rem.substr(0, pos);
-    _rem.erase(0, pos);
+    _rem.take(line, pos);
     return 1;
 }
+
+// Drops bytes which were parsed right in the buffer
+void
+IO::discard(std::size_t size) {
+    _rem.consume(size);
+}
+
+// Writes up to size buffered bytes into fd, without a copy.
+// Returns number of bytes written, 0 if nothing is buffered, or -1.
+long
+IO::spill(int fd, int64_t size) {
+
+    std::size_t bytes = _rem.size();
+    if (size >= 0 && static_cast<uint64_t>(size) < bytes) {
+        bytes = size;
+    }
+
+    long written = 0;
+    while (bytes > 0) {
+        long res = _rem.writeTo(fd, bytes);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue ;
+            }
+            return -1;
+        }
+        if (res == 0) {
+            break ;
+        }
+        written += res;
+        bytes -= res;
+    }
+    return written;
+}
@@ -75,6 +75,11 @@ Location::getProxyPass(void) const {
     return _proxy_pass;
 }
 
+std::string &
+Location::getWorkerPoolRef(void) {
+    return _workerPool;
+}
+
 Headers<ResponseHeader> &
 Location::getHeaders(void) {
     return _headers;
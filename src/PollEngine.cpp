@@ -0,0 +1,149 @@
+#include "PollEngine.hpp"
+
+static const std::size_t reservedFds = 64;
+
+static short
+toPoll(uint32_t events) {
+    short res = 0;
+    if (events & EVENT_IN) {
+        res |= POLLIN;
+    }
+    if (events & EVENT_OUT) {
+        res |= POLLOUT;
+    }
+    return res;
+}
+
+static uint32_t
+fromPoll(short revents) {
+    uint32_t res = EVENT_NONE;
+    if (revents & POLLIN) {
+        res |= EVENT_IN;
+    }
+    if (revents & POLLOUT) {
+        res |= EVENT_OUT;
+    }
+    if (revents & POLLHUP) {
+        res |= EVENT_HUP;
+    }
+    if (revents & POLLERR) {
+        res |= EVENT_ERR;
+    }
+    return res;
+}
+
+PollEngine::PollEngine(void) {}
+
+PollEngine::~PollEngine(void) {}
+
+const char *
+PollEngine::name(void) const {
+    return "poll";
+}
+
+int
+PollEngine::init(void) {
+    _pollfds.reserve(reservedFds);
+    _index.reserve(reservedFds);
+    return 0;
+}
+
+// Returns index of fd in pollfds, or -1
+int
+PollEngine::find(int fd) const {
+    if (fd < 0 || static_cast<std::size_t>(fd) >= _index.size()) {
+        return -1;
+    }
+    return _index[fd];
+}
+
+// Slots of removed descriptors are reused first.
+// Edge-triggered mode is not available for poll,
+// so EVENT_EDGE is silently ignored here.
+int
+PollEngine::add(int fd, uint32_t events) {
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (find(fd) >= 0) {
+        return mod(fd, events);
+    }
+
+    if (static_cast<std::size_t>(fd) >= _index.size()) {
+        _index.resize(fd + 1, -1);
+    }
+
+    struct pollfd tmp = { fd, toPoll(events), 0 };
+
+    int id = -1;
+    if (!_free.empty()) {
+        id = _free.back();
+        _free.pop_back();
+        _pollfds[id] = tmp;
+    } else {
+        id = _pollfds.size();
+        _pollfds.push_back(tmp);
+    }
+    _index[fd] = id;
+    return 0;
+}
+
+int
+PollEngine::mod(int fd, uint32_t events) {
+
+    int id = find(fd);
+    if (id < 0) {
+        return -1;
+    }
+    _pollfds[id].events = toPoll(events);
+    return 0;
+}
+
+int
+PollEngine::del(int fd) {
+
+    int id = find(fd);
+    if (id < 0) {
+        return -1;
+    }
+    _pollfds[id].fd = -1;
+    _pollfds[id].events = 0;
+    _pollfds[id].revents = 0;
+
+    _index[fd] = -1;
+    _free.push_back(id);
+    return 0;
+}
+
+int
+PollEngine::wait(int timeout) {
+
+    _nbReady = 0;
+
+    int res = ::poll(_pollfds.data(), _pollfds.size(), timeout);
+    if (res <= 0) {
+        return res;
+    }
+
+    if (_ready.size() < static_cast<std::size_t>(res)) {
+        _ready.resize(res);
+    }
+
+    for (iter_pfd it = _pollfds.begin(); it != _pollfds.end() && _nbReady < static_cast<std::size_t>(res); ++it) {
+
+        if (it->fd < 0 || it->revents == 0) {
+            continue ;
+        }
+
+        if (!(it->revents & POLLNVAL)) {
+            _ready[_nbReady].fd = it->fd;
+            _ready[_nbReady].events = fromPoll(it->revents);
+            _nbReady++;
+        }
+        it->revents = 0;
+    }
+
+    return _nbReady;
+}
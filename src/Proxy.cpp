@@ -70,7 +70,7 @@ int Proxy::setConnection(struct addrinfo *lst, Request *req) {
     getsockname(sock->rdFd(), (struct sockaddr *)&ownAddr, &ownAddrSize);
     Log.debug() << "Proxy:: [" << fd << "] Established from " << inet_ntoa(ownAddr.sin_addr) << ":" << ntohs(ownAddr.sin_port) << Log.endl;
 
-    g_server->link(sock->rdFd(), req->getClient());
+    req->getClient()->getReactor()->link(sock->rdFd(), req->getClient());
     return 1;
 }
 
@@ -0,0 +1,848 @@
+#include "Reactor.hpp"
+#include "Server.hpp"
+
+std::size_t Reactor::count = 0;
+
+const std::size_t reservedClients = 64;
+const std::size_t maxFdTableSize = 1 << 20;
+const long        maxPollTimeout = 86400;
+const std::size_t queueCapacity = 4096;
+
+Reactor::Reactor(void)
+    : _id(count++)
+    , _engine(NULL) {
+    _clients.reserve(reservedClients);
+
+    _q_links.init(queueCapacity);
+    _q_armPfds.init(queueCapacity);
+}
+
+Reactor::~Reactor(void) {
+
+    for (iter_cv it = _clients.begin(); it != _clients.end(); ++it) {
+        if (*it != NULL) {
+            delete *it;
+        }
+    }
+
+    for (std::size_t i = 0; i < _sockets.size(); ++i) {
+        close(_sockets[i]->rdFd());
+        delete _sockets[i];
+    }
+
+    if (_engine != NULL) {
+        delete _engine;
+    }
+}
+
+int Reactor::id(void) const {
+    return _id;
+}
+
+int Reactor::init(void) {
+
+    if (initFdTables() < 0) {
+        return -1;
+    }
+
+    _engine = AEngine::create(g_server->settings.event_engine);
+    if (_engine == NULL) {
+        Log.error() << "Reactor " << _id << ":: Cannot initialize " << g_server->settings.event_engine << " engine" << Log.endl;
+        return -1;
+    }
+
+    if (_waker.init() < 0 || _engine->add(_waker.fd(), EVENT_IN) < 0) {
+        Log.error() << "Reactor " << _id << ":: Cannot initialize waker" << Log.endl;
+        return -1;
+    }
+    return 0;
+}
+
+// Descriptors are indexed directly, so tables are allocated once
+// for the whole descriptors limit and never resized afterwards.
+int Reactor::initFdTables(void) {
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0) {
+        Log.syserr() << "Reactor::getrlimit failed" << Log.endl;
+        return -1;
+    }
+
+    std::size_t size = maxFdTableSize;
+    if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < maxFdTableSize) {
+        size = rl.rlim_cur;
+    }
+
+    _connector.assign(size, -1);
+    _listeners.assign(size, -1);
+
+    Log.debug() << "Reactor " << _id << ":: descriptors table size is " << size << Log.endl;
+    return 0;
+}
+
+int Reactor::create(void) {
+    if (pthread_create(&_thread, NULL, _cycle, this)) {
+        Log.syserr() << "Server::pthread_create failed for reactor " << _id << Log.endl;
+        return 0;
+    }
+    return 1;
+}
+
+int Reactor::join(void) {
+    if (pthread_join(_thread, NULL)) {
+        Log.syserr() << "Server::pthread_join failed for reactor " << _id << Log.endl;
+        return 0;
+    }
+    return 1;
+}
+
+void *
+Reactor::_cycle(void *ptr) {
+    Reactor *r = reinterpret_cast<Reactor *>(ptr);
+
+    Affinity::pinReactor(r->id());
+
+    Log.debug() << "Reactor " << r->id() << "::cycle started" << Log.endl;
+    r->loop();
+    Log.debug() << "Reactor " << r->id() << "::cycle stopped" << Log.endl;
+    return NULL;
+}
+
+void Reactor::loop(void) {
+
+    while (g_server->working()) {
+        emptyNewFdsQ();
+
+        if (poll() > 0) {
+            process();
+        }
+        checkTimeout();
+        checkUnlinkedClients();
+
+        emptyDelFdsQ();
+        emptyDelClientQ();
+    }
+}
+
+int Reactor::addListenSocket(const std::string &addr, std::size_t port) {
+    IO *sock = new IO();
+    if (sock == NULL) {
+        Log.syserr() << "Reactor:: Cannot allocate memory for IO" << Log.endl;
+        return -1;
+    }
+
+    if (sock->socket() < 0) {
+        delete sock;
+        return -1;
+    }
+
+    if (sock->listen(addr, port) < 0 || sock->nonblock() < 0) {
+        close(sock->rdFd());
+        delete sock;
+        return -1;
+    }
+    // Listening sockets are always level-triggered,
+    // so pending connections are never lost between iterations
+    if (_engine->listen(sock->rdFd()) < 0) {
+        close(sock->rdFd());
+        delete sock;
+        return -1;
+    }
+    _listeners[sock->rdFd()] = _sockets.size();
+    _sockets.push_back(sock);
+
+    return 0;
+}
+
+void
+Reactor::pollin(int fd) {
+
+    HTTP::Client *client = linkedClient(fd);
+    if (client == NULL) {
+        Log.debug() << "Reactor::pollin:: [" << fd << "] is not linked" << Log.endl;
+        return ;
+    }
+
+    if (client->relaying()) {
+        client->tryRelay(fd);
+        return ;
+    }
+
+    // In edge-triggered mode readiness is reported once,
+    // so descriptor should be read until it's drained
+    const bool edge = g_server->settings.edge_triggered;
+
+    if (fd == client->getClientIO()->rdFd()) {
+        IO *io = client->getClientIO();
+        do {
+            io->full(false);
+            client->tryReceiveRequest(fd);
+        } while (edge && io->rdFd() == fd && io->full());
+
+    } else if (fd == client->getGatewayIO()->rdFd()) {
+        IO *io = client->getGatewayIO();
+        do {
+            io->full(false);
+            client->tryReceiveResponse(fd);
+        } while (edge && io->rdFd() == fd && io->full());
+    }
+}
+
+// Data received by the engine is handled as if it was read
+void
+Reactor::received(int fd, const char *data, int res) {
+
+    HTTP::Client *client = linkedClient(fd);
+    if (client == NULL) {
+        Log.debug() << "Reactor::received:: [" << fd << "] is not linked" << Log.endl;
+        return ;
+    }
+
+    IO *io = client->getClientIO();
+    if (client->relaying() || fd != io->rdFd()) {
+        Log.debug() << "Reactor::received:: [" << fd << "] is not streamed" << Log.endl;
+        return ;
+    }
+
+    if (io->deliver(data, res) < 0) {
+        pollerr(fd);
+        return ;
+    }
+    pollin(fd);
+}
+
+// Output given to the engine has left, the rest of it is given
+void
+Reactor::sent(int fd, int res) {
+
+    HTTP::Client *client = linkedClient(fd);
+    if (client == NULL) {
+        Log.debug() << "Reactor::sent:: [" << fd << "] is not linked" << Log.endl;
+        return ;
+    }
+
+    IO *io = client->getClientIO();
+    if (fd != io->wrFd()) {
+        return ;
+    }
+
+    io->sent(res);
+    pollout(fd);
+}
+
+void
+Reactor::pollout(int fd) {
+
+    HTTP::Client *client = linkedClient(fd);
+    if (client == NULL) {
+        Log.debug() << "Reactor::pollout:: [" << fd << "] is not linked" << Log.endl;
+        return ;
+    }
+
+    Stats::incLocal(STAT_WRITE_EVENTS);
+    if (!client->hasPendingOutput(fd)) {
+        Stats::incLocal(STAT_SPURIOUS_WRITES);
+    }
+
+    if (client->relaying()) {
+        client->tryRelay(fd);
+        return ;
+    }
+
+    if (fd == client->getClientIO()->wrFd()) {
+        client->tryReplyResponse(fd);
+
+    } else if (fd == client->getGatewayIO()->wrFd()) {
+        client->tryReplyRequest(fd);
+    }
+}
+
+void
+Reactor::pollhup(int fd) {
+
+    Log.syserr() << "Reactor::pollhup [" << fd << "]" << Log.endl;
+
+    HTTP::Client *client = linkedClient(fd);
+    if (client == NULL) {
+        Log.debug() << "Reactor::pollhup:: [" << fd << "] is not linked" << Log.endl;
+        return ;
+    }
+
+    if (client->relaying()) {
+        client->hangup(fd);
+        return ;
+    }
+
+    if (fd == client->getClientIO()->rdFd()) {
+        unlink(fd);
+
+    } else if (fd == client->getGatewayIO()->wrFd()) {
+        unlink(fd);
+
+    } else if (fd == client->getGatewayIO()->rdFd()) {
+        client->tryReceiveResponse(fd);
+        unlink(fd);
+    }
+}
+
+void
+Reactor::pollerr(int fd) {
+    Log.syserr() << "Reactor::pollerr [" << fd << "]" << Log.endl;
+
+    HTTP::Client *client = linkedClient(fd);
+    if (client == NULL) {
+        Log.debug() << "Reactor::pollerr:: [" << fd << "] is not linked" << Log.endl;
+        return ;
+    }
+
+    if (client->relaying()) {
+        client->hangup(fd);
+        return ;
+    }
+
+    if (fd == client->getClientIO()->rdFd()) {
+        unlink(fd);
+
+    } else if (fd == client->getGatewayIO()->wrFd()) {
+        unlink(fd);
+
+    } else if (fd == client->getGatewayIO()->rdFd()) {
+        unlink(fd);
+    }
+}
+
+void Reactor::process(void) {
+
+    const bool edge = g_server->settings.edge_triggered;
+
+    for (std::size_t i = 0; i < _engine->ready(); i++) {
+
+        const AEngine::Event &event = (*_engine)[i];
+
+        const int      fd = event.fd;
+        const uint32_t events = event.events;
+
+        if (fd == _waker.fd()) {
+            _waker.drain();
+            continue ;
+        }
+
+        const int servid = _listeners[fd];
+        if (servid >= 0) {
+            if (events & EVENT_COMPLETE) {
+                accepted(servid, event.res);
+            } else if (events & EVENT_IN) {
+                connect(servid);
+            }
+        } else if (events & EVENT_COMPLETE) {
+            if (events & EVENT_ERR) {
+                pollerr(fd);
+            } else if (events & EVENT_OUT) {
+                sent(fd, event.res);
+            } else {
+                received(fd, event.data, event.res);
+            }
+        } else {
+            if (events & EVENT_IN) {
+                pollin(fd);
+                // Edge is reported once, so neither hangup after the
+                // data (short read doesn't see the end of it) nor
+                // writability should be lost
+                if (edge && (events & EVENT_HUP)) {
+                    pollhup(fd);
+                } else if (edge && (events & EVENT_OUT)) {
+                    pollout(fd);
+                }
+            } else if (events & EVENT_HUP) {
+                pollhup(fd);
+            } else if (events & EVENT_OUT) {
+                pollout(fd);
+            } else if (events & EVENT_ERR) {
+                pollerr(fd);
+            }
+        }
+    }
+}
+
+// Waiting lasts till the nearest timer, or forever if there are
+// none. Other threads interrupt it through the waker.
+int Reactor::pollTimeout(void) {
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    long timeout = _timers.nextTimeout(now.tv_sec);
+    if (timeout < 0) {
+        return -1;
+    }
+    if (timeout > maxPollTimeout) {
+        timeout = maxPollTimeout;
+    }
+
+    timeout = timeout * 1000 - now.tv_usec / 1000;
+    return (timeout > 0) ? static_cast<int>(timeout) : 0;
+}
+
+int Reactor::poll(void) {
+
+    int res = _engine->wait(pollTimeout());
+
+    if (res < 0) {
+        if (g_server->working() && errno != EINTR) {
+            Log.syserr() << "Reactor::poll" << Log.endl;
+        }
+    } else {
+        Stats::incLocal(STAT_WAKEUPS);
+        Stats::addLocal(STAT_EVENTS, res);
+    }
+    return res;
+}
+
+uint32_t
+Reactor::interest(bool in, bool out, bool stream) const {
+    uint32_t events = EVENT_NONE;
+    if (in) {
+        events |= EVENT_IN;
+    }
+    if (out) {
+        events |= EVENT_OUT;
+    }
+    if (stream) {
+        events |= EVENT_STREAM;
+    }
+    if (g_server->settings.edge_triggered) {
+        events |= EVENT_EDGE;
+    }
+    return events;
+}
+
+// Connection of the client is given to a completion-based engine,
+// unless it's relayed by a tunnel, which does its I/O itself
+bool
+Reactor::streamed(HTTP::Client *client, int fd) const {
+    return _engine->completes() && fd == client->getClientIO()->rdFd() && !client->relaying();
+}
+
+// Only expired timers are touched, not every client
+void
+Reactor::checkTimeout(void) {
+
+    _expired.clear();
+    _timers.advance(Time::now(), _expired);
+
+    for (std::size_t i = 0; i < _expired.size(); ++i) {
+        HTTP::Client *client = static_cast<HTTP::Client *>(_expired[i]->data);
+        client->timeoutExpired(_expired[i]->kind);
+    }
+}
+
+// Clients without linked descriptors are removed as soon
+// as workers have finished with them, till then they're kept
+// in the drained list
+void
+Reactor::checkUnlinkedClients(void) {
+
+    if (_unlinkedClients.empty()) {
+        return ;
+    }
+
+    std::sort(_unlinkedClients.begin(), _unlinkedClients.end());
+    _unlinkedClients.erase(std::unique(_unlinkedClients.begin(), _unlinkedClients.end()), _unlinkedClients.end());
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < _unlinkedClients.size(); ++i) {
+        HTTP::Client *client = _unlinkedClients[i];
+
+        if (client->links != 0) {
+            continue ;
+        }
+
+        // Worker is handling its response, retried on the next wakeup
+        if (!client->getCancelToken()->cancel()) {
+            _unlinkedClients[kept++] = client;
+            continue ;
+        }
+        addToDelClientQ(client);
+    }
+    _unlinkedClients.resize(kept);
+}
+
+bool
+Reactor::inLoop(void) const {
+    return pthread_equal(pthread_self(), _thread);
+}
+
+// Slots of removed clients are reused first
+void
+Reactor::addClient(HTTP::Client *client) {
+
+    int id = -1;
+    if (!_freeIds.empty()) {
+        id = _freeIds.back();
+        _freeIds.pop_back();
+        _clients[id] = client;
+    } else {
+        id = _clients.size();
+        _clients.push_back(client);
+    }
+
+    client->setId(id);
+}
+
+// Workers only queue the request, tables are changed by the
+// event loop. Loop applies queued requests first, so requests
+// for the same descriptor are never reordered.
+void
+Reactor::link(int fd, HTTP::Client *client) {
+
+    if (fd < 0 || static_cast<std::size_t>(fd) >= _connector.size()) {
+        Log.error() << "Reactor::link [" << fd << "] is out of descriptors table" << Log.endl;
+        return ;
+    }
+
+    if (!inLoop()) {
+        Link l = { fd, client };
+        _q_links.push(l);
+        wakeup();
+        return ;
+    }
+
+    emptyLinksQ();
+    linkFd(fd, client);
+}
+
+// Descriptor is closed by the event loop in emptyDelFdsQ
+// right after it's removed from the engine
+void
+Reactor::unlink(int fd) {
+
+    if (fd < 0 || static_cast<std::size_t>(fd) >= _connector.size()) {
+        return ;
+    }
+
+    if (!inLoop()) {
+        Link l = { fd, NULL };
+        _q_links.push(l);
+        wakeup();
+        return ;
+    }
+
+    emptyLinksQ();
+    unlinkFd(fd);
+}
+
+void
+Reactor::linkFd(int fd, HTTP::Client *client) {
+
+    _connector[fd] = client->getId();
+    client->links++;
+
+    addToNewFdsQ(fd);
+}
+
+// Clients without linked descriptors are checked for removal
+// at the end of the loop pass
+void
+Reactor::unlinkFd(int fd) {
+
+    int id = _connector[fd];
+    if (id < 0 || _clients[id] == NULL) {
+        return ;
+    }
+
+    HTTP::Client *client = _clients[id];
+
+    _connector[fd] = -1;
+    client->links--;
+    if (client->links == 0) {
+        _unlinkedClients.push_back(client);
+    }
+
+    addToDelFdsQ(fd);
+}
+
+// Returns client which fd is linked to, or NULL.
+// Event loop thread only, as the tables are.
+HTTP::Client *
+Reactor::linkedClient(int fd) {
+
+    if (fd < 0 || static_cast<std::size_t>(fd) >= _connector.size()) {
+        return NULL;
+    }
+
+    int id = _connector[fd];
+    if (id < 0) {
+        return NULL;
+    }
+    return _clients[id];
+}
+
+// Asks event loop to watch fd for writing, as output for it
+// could be pending now (and to check whether fd should still be
+// read). Could be called from any thread; the actual state is
+// checked by the loop in emptyNewFdsQ.
+void
+Reactor::armWrite(int fd) {
+
+    if (fd < 0) {
+        return ;
+    }
+
+    _q_armPfds.push(fd);
+
+    wakeup();
+}
+
+// Zero expiration time cancels the timer.
+// Event loop thread only.
+void
+Reactor::schedule(Timer *timer, std::time_t expires) {
+
+    if (expires == 0) {
+        _timers.remove(timer);
+    } else {
+        _timers.add(timer, expires);
+    }
+}
+
+// Stops watching fd for writing when nothing is left to send.
+// Event loop thread only.
+void
+Reactor::disarmWrite(int fd) {
+
+    if (fd < 0) {
+        return ;
+    }
+
+    HTTP::Client *client = linkedClient(fd);
+    if (client == NULL) {
+        return ;
+    }
+    _engine->mod(fd, interest(client->wantsInput(fd), false, streamed(client, fd)));
+}
+
+// Interrupts waiting of the event loop, so changes made by
+// other threads are picked up without delay. Could be called
+// from any thread; from the loop itself it's not needed.
+void Reactor::wakeup(void) {
+    if (!pthread_equal(pthread_self(), _thread)) {
+        _waker.notify();
+    }
+}
+
+// Backlog is drained in one pass, but not more than accept_budget
+// connections are taken per wakeup, so a storm of connections
+// can't starve already connected clients.
+void Reactor::connect(std::size_t servid) {
+
+    IO *listener = _sockets[servid];
+    const std::size_t budget = g_server->settings.accept_budget;
+
+    std::size_t accepted = 0;
+    for (; accepted < budget; ++accepted) {
+
+        struct sockaddr_in clientData;
+
+        int fd = listener->accept(clientData);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED) {
+                Log.syserr() << "Reactor::accept [" << listener->rdFd() << "]" << Log.endl;
+                Stats::inc(STAT_ACCEPT_ERRORS);
+            }
+            break ;
+        }
+
+        if (!addConnection(listener, fd, clientData)) {
+            break ;
+        }
+    }
+
+    Stats::addLocal(STAT_ACCEPTED, accepted);
+    if (accepted == budget) {
+        Stats::inc(STAT_ACCEPT_BUDGET_EXHAUSTED);
+    }
+}
+
+// Connection accepted by the engine. Multishot accept takes
+// the backlog as it comes, so there's no budget for it.
+void Reactor::accepted(std::size_t servid, int fd) {
+
+    IO *listener = _sockets[servid];
+
+    if (fd < 0) {
+        if (fd != -EAGAIN && fd != -EINTR && fd != -ECONNABORTED) {
+            errno = -fd;
+            Log.syserr() << "Reactor::accept [" << listener->rdFd() << "]" << Log.endl;
+            Stats::inc(STAT_ACCEPT_ERRORS);
+        }
+        return ;
+    }
+
+    struct sockaddr_in clientData;
+    socklen_t len = sizeof(clientData);
+    std::memset(&clientData, 0, sizeof(clientData));
+    getpeername(fd, reinterpret_cast<struct sockaddr *>(&clientData), &len);
+
+    if (addConnection(listener, fd, clientData)) {
+        Stats::incLocal(STAT_ACCEPTED);
+    }
+}
+
+// Returns false if the client can't be allocated
+bool Reactor::addConnection(IO *listener, int fd, const struct sockaddr_in &clientData) {
+
+    if (static_cast<std::size_t>(fd) >= _connector.size()) {
+        Log.error() << "Reactor::accept [" << fd << "] is out of descriptors table" << Log.endl;
+        Stats::inc(STAT_ACCEPT_ERRORS);
+        close(fd);
+        return true;
+    }
+
+    HTTP::Client *client = new HTTP::Client();
+    if (client == NULL) {
+        Log.syserr() << "Reactor::Cannot allocate memory for Client" << Log.endl;
+        close(fd);
+        return false;
+    }
+
+    client->setReactor(this);
+    client->setServerIO(listener);
+    client->setClientTimeout(Time::now());
+    client->getClientIO()->rdFd(fd);
+    client->getClientIO()->wrFd(fd);
+    client->getClientIO()->setAddr(inet_ntoa(clientData.sin_addr));
+    client->getClientIO()->setPort(ntohs(clientData.sin_port));
+    if (_engine->completes()) {
+        client->getClientIO()->engine(_engine);
+    }
+
+    addClient(client);
+    link(fd, client);
+    client->checkIdle();
+
+    Log.debug() << "Reactor " << _id << "::connect [" << fd << "] -> " << client->getHostname() << Log.endl;
+    return true;
+}
+
+// The functions below used to work with different queues.
+// Shared queues are lock-free, so workers never wait for the loop;
+// descriptors lists are filled by the loop itself.
+
+void Reactor::addToNewFdsQ(int fd) {
+
+    if (fd < 0) {
+        return ;
+    }
+
+    Log.debug() << "Reactor::addToNewFdsQ [" << fd << "]" << Log.endl;
+    _newPfds.push_back(fd);
+}
+
+void Reactor::addToDelFdsQ(int fd) {
+
+    if (fd < 0) {
+        return ;
+    }
+
+    Log.debug() << "Reactor::addToDelFdsQ [" << fd << "]" << Log.endl;
+    _delPfds.push_back(fd);
+}
+
+// Clients are removed by the loop only, so it's not a shared queue
+void Reactor::addToDelClientQ(HTTP::Client *client) {
+
+    if (client != NULL) {
+        Log.debug() << "Reactor::addToDelClientQ -> " << client << Log.endl;
+        _delClients.push_back(client);
+    }
+}
+
+// Links queued by workers, applied in the order they were made
+void Reactor::emptyLinksQ(void) {
+
+    _links.clear();
+    if (_q_links.drain(_links) == 0) {
+        return ;
+    }
+
+    for (std::size_t i = 0; i < _links.size(); ++i) {
+        if (_links[i].client != NULL) {
+            linkFd(_links[i].fd, _links[i].client);
+        } else {
+            unlinkFd(_links[i].fd);
+        }
+    }
+}
+
+void Reactor::emptyNewFdsQ(void) {
+
+    // Arming is taken before links: descriptor is always
+    // linked before it could be armed, so arming of
+    // a descriptor is never handled before its adding
+    _armPfds.clear();
+    _q_armPfds.drain(_armPfds);
+
+    emptyLinksQ();
+
+    for (std::size_t i = 0; i < _newPfds.size(); ++i) {
+
+        const int tmpfd = _newPfds[i];
+
+        HTTP::Client *client = linkedClient(tmpfd);
+        if (client == NULL) {
+            continue ;
+        }
+        _engine->add(tmpfd, interest(client->wantsInput(tmpfd), client->hasPendingOutput(tmpfd), streamed(client, tmpfd)));
+
+        Log.debug() << "Reactor::emptyNewFdsQ [" << tmpfd << "]" << Log.endl;
+    }
+    _newPfds.clear();
+
+    if (_armPfds.empty()) {
+        return ;
+    }
+
+    std::sort(_armPfds.begin(), _armPfds.end());
+    _armPfds.erase(std::unique(_armPfds.begin(), _armPfds.end()), _armPfds.end());
+
+    // Engine is modified even if interest is unchanged, so in
+    // edge-triggered mode the current state is reported again
+    for (std::size_t i = 0; i < _armPfds.size(); ++i) {
+
+        HTTP::Client *client = linkedClient(_armPfds[i]);
+        if (client == NULL) {
+            continue ;
+        }
+        _engine->mod(_armPfds[i], interest(client->wantsInput(_armPfds[i]), client->hasPendingOutput(_armPfds[i]), streamed(client, _armPfds[i])));
+    }
+}
+
+void Reactor::emptyDelFdsQ(void) {
+
+    for (std::size_t i = 0; i < _delPfds.size(); ++i) {
+
+        const int tmpfd = _delPfds[i];
+
+        _engine->del(tmpfd);
+        close(tmpfd);
+
+        Log.debug() << "Reactor::emptyDelFdsQ [" << tmpfd << "]" << Log.endl;
+    }
+    _delPfds.clear();
+}
+
+void Reactor::emptyDelClientQ(void) {
+
+    for (std::size_t i = 0; i < _delClients.size(); ++i) {
+
+        HTTP::Client *client = _delClients[i];
+
+        _clients[client->getId()] = NULL;
+        _freeIds.push_back(client->getId());
+
+        Log.debug() << "Reactor::emptyDelClientQ -> " << client << Log.endl;
+
+        delete client;
+    }
+    _delClients.clear();
+}
@@ -42,6 +42,7 @@ Request::operator=(const Request &other) {
         _cookie       = other._cookie;
         _host         = other._host;
         _useRanges    = other._useRanges;
+        _parser       = other._parser;
         headers       = other.headers;
     }
     return *this;
@@ -152,23 +153,72 @@ Request::useRanges(bool flag) {
     _useRanges = flag;
 }
 
+// Head is parsed by parseHead(), lines are the body's
 bool
 Request::parseLine(std::string &line) {
 
     if (getStatus() < BAD_REQUEST) {
 
-        if (!flagSet(PARSED_SL)) {
-            rtrim(line, CRLF);
-            setStatus(!line.empty() ? parseSL(line) : CONTINUE);
-        } else if (!flagSet(PARSED_HEADERS)) {
-            rtrim(line, CRLF);
-            setStatus(!line.empty() ? parseHeader(line) : checkHeaders());
-        } else if (!flagSet(PARSED_BODY)) {
+        if (!flagSet(PARSED_BODY)) {
             setStatus(parseBody(line));
         } else {
             setStatus(PROCESSING);
         }
     }
+    return checkFormed();
+}
+
+// Head is parsed right in the input buffer, strings are made only for
+// the parts which are kept. Returns length of the head once it's parsed
+// (it could be dropped from the buffer), or 0 if more data is needed.
+// Invalid head takes the whole buffer: the connection is closed after
+// the error, so nothing else is parsed from it.
+std::size_t
+Request::parseHead(const ChainBuffer &buf) {
+
+    StatusCode status = _parser.parse(buf);
+    if (status == CONTINUE) {
+        return 0;
+    }
+    if (status != PROCESSING) {
+        setStatus(status);
+        checkFormed();
+        return buf.size();
+    }
+
+    // Head of a typical request is in the first slab
+    std::size_t len;
+    std::string linear;
+    const char *head = buf.front(len);
+    if (len < _parser.length()) {
+        buf.copy(linear, _parser.length());
+        head = linear.data();
+    }
+
+    setStatus(parseSL(head));
+    for (std::size_t i = 0; i < _parser.fields() && getStatus() == CONTINUE; ++i) {
+        setStatus(parseField(head, _parser.field(i)));
+    }
+    if (getStatus() == CONTINUE) {
+        setStatus(checkHeaders());
+    }
+
+    checkFormed();
+    return _parser.length();
+}
+
+// Body bytes were moved from the input into the upload file
+bool
+Request::parseUpload(long bytes) {
+
+    if (getStatus() < BAD_REQUEST) {
+        setStatus(writeUpload(bytes));
+    }
+    return checkFormed();
+}
+
+bool
+Request::checkFormed(void) {
 
     if (getStatus() != CONTINUE) {
         if (!_servBlock) {
@@ -190,31 +240,18 @@ Request::parseLine(std::string &line) {
 }
 
 StatusCode
-Request::parseSL(const std::string &line) {
+Request::parseSL(const char *head) {
 
-    Log.debug() << line << Log.endl;
-
-    std::size_t pos = 0;
-    _method = getWord(line, " ", pos);
-
-    skipSpaces(line, pos);
-    _rawURI = getWord(line, " ", pos);
-    if (_rawURI.length() > g_server->settings.max_uri_length) {
-        Log.debug() << "Request:: URI is too long: " << _rawURI << Log.endl;
-        return URI_TOO_LONG;
-    }
+    const RequestParser::Token &method = _parser.method();
+    const RequestParser::Token &uri = _parser.uri();
+    const RequestParser::Token &protocol = _parser.protocol();
 
+    _method.assign(head + method.off, method.len);
+    _rawURI.assign(head + uri.off, uri.len);
     _uri.parse(_rawURI);
+    setProtocol(std::string(head + protocol.off, protocol.len));
 
-    skipSpaces(line, pos);
-    setProtocol(getWord(line, " ", pos));
-
-    skipSpaces(line, pos);
-
-    if (tunnelGuard(line[pos])) {
-        Log.debug() << "Request:: Forbidden symbols at the end of the SL: " << Log.endl;
-        return BAD_REQUEST;
-    }
+    Log.debug() << _method << " " << _rawURI << " " << getProtocol() << Log.endl;
     return checkSL();
 }
 
@@ -388,23 +425,50 @@ Request::checkHeaders(void) {
         }
     }
     Log.debug() << "Request::ParsedHeaders::Continue" << Log.endl;
-    return CONTINUE;
+    return openUpload();
 }
 
+// Body of PUT or POST with known length, which is going to be
+// stored as is, bypasses the parser and memory. Otherwise (or if
+// the file couldn't be created there) body is collected as usual.
 StatusCode
-Request::parseHeader(const std::string &line) {
+Request::openUpload(void) {
 
-    RequestHeader header;
+    if (chunked() || !has(CONTENT_LENGTH) || getExpBodySize() <= 0) {
+        return CONTINUE;
+    }
+    if (isProxy() || isCGI() || !authorized() || getLocation()->getRedirectRef().set()) {
+        return CONTINUE;
+    }
 
-    if (tunnelGuard(!header.parse(line))) {
-        Log.debug() << "Request:: Invalid header " << line << Log.endl;
-        return BAD_REQUEST;
+    std::string dir;
+    if (_method == "PUT" && !isDirectory(_resolvedPath)) {
+        std::size_t pos = _resolvedPath.find_last_of('/');
+        dir = (pos == std::string::npos ? "." : _resolvedPath.substr(0, pos));
+    } else if (_method == "POST" && isDirectory(_resolvedPath)) {
+        dir = _resolvedPath;
+    } else {
+        return CONTINUE;
     }
 
-    if (tunnelGuard(header.value.length() > g_server->settings.max_header_field_length)) {
-        Log.debug() << "Request:: Header is too large: " << line << Log.endl;
-        return REQUEST_HEADER_FIELDS_TOO_LARGE;
+    if (!createUploadFile(dir) && errno == ENOSPC) {
+        return INSUFFICIENT_STORAGE;
     }
+    return CONTINUE;
+}
+
+// Length of the field is checked by the parser
+StatusCode
+Request::parseField(const char *head, const RequestParser::Field &field) {
+
+    RequestHeader header;
+    header.parse(head + field.name.off, field.name.len, head + field.value.off, field.value.len);
+
+    return insertHeader(header);
+}
+
+StatusCode
+Request::insertHeader(const RequestHeader &header) {
 
     // dublicate header
     if (tunnelGuard(has(header.hash))) {
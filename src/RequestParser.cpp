@@ -0,0 +1,264 @@
+#include "RequestParser.hpp"
+#include "Server.hpp"
+
+namespace HTTP {
+
+static const std::size_t MAX_TOKEN_LENGTH = 16;
+
+// Spaces between the parts of the start line are not limited by the
+// grammar, so the whole line is: the longest valid one is allowed
+static std::size_t
+maxLineLength(void) {
+    return g_server->settings.max_uri_length + 2 * MAX_TOKEN_LENGTH + 2;
+}
+
+RequestParser::RequestParser(void)
+    : _state(S_START)
+    , _pos(0)
+    , _valueEnd(0)
+    , _nbFields(0) {
+
+    Token empty = { 0, 0 };
+    _method = empty;
+    _uri = empty;
+    _protocol = empty;
+}
+
+// Returns CONTINUE while the head is incomplete, PROCESSING once
+// it's complete, or the error status. Limits of the URI and header
+// fields are checked while scanning, so the head can't grow forever.
+StatusCode
+RequestParser::parse(const ChainBuffer &buf) {
+
+    while (_state != S_DONE) {
+        std::size_t len;
+        const char *data = buf.peek(_pos, len);
+        if (data == NULL) {
+            return CONTINUE;
+        }
+
+        for (std::size_t i = 0; i < len && _state != S_DONE; ++i, ++_pos) {
+            StatusCode status = step(data[i]);
+            if (status != CONTINUE) {
+                return status;
+            }
+        }
+    }
+    return PROCESSING;
+}
+
+StatusCode
+RequestParser::step(char c) {
+
+    const std::size_t max_uri_length = g_server->settings.max_uri_length;
+    const std::size_t max_field_length = g_server->settings.max_header_field_length;
+
+    switch (_state) {
+
+    // Empty lines before the request are skipped
+    case S_START:
+        if (c != '\r' && c != '\n') {
+            _method.off = _pos;
+            _state = S_METHOD;
+        } else if (_pos >= max_uri_length) {
+            return BAD_REQUEST;
+        }
+        break ;
+
+    case S_METHOD:
+        if (c == ' ' || c == '\r' || c == '\n') {
+            _method.len = _pos - _method.off;
+            if (c == ' ') {
+                _state = S_SP_URI;
+            } else {
+                endLine(c);
+            }
+        } else if (_pos - _method.off > MAX_TOKEN_LENGTH) {
+            return BAD_REQUEST;
+        }
+        break ;
+
+    case S_SP_URI:
+        if (c == '\r' || c == '\n') {
+            endLine(c);
+        } else if (c != ' ') {
+            _uri.off = _pos;
+            _state = S_URI;
+        } else if (_pos - _method.off >= maxLineLength()) {
+            return BAD_REQUEST;
+        }
+        break ;
+
+    case S_URI:
+        if (c == ' ' || c == '\r' || c == '\n') {
+            _uri.len = _pos - _uri.off;
+            if (c == ' ') {
+                _state = S_SP_PROTOCOL;
+            } else {
+                endLine(c);
+            }
+        } else if (_pos - _uri.off >= max_uri_length) {
+            Log.debug() << "RequestParser:: URI is too long" << Log.endl;
+            return URI_TOO_LONG;
+        }
+        break ;
+
+    case S_SP_PROTOCOL:
+        if (c == '\r' || c == '\n') {
+            endLine(c);
+        } else if (c != ' ') {
+            _protocol.off = _pos;
+            _state = S_PROTOCOL;
+        } else if (_pos - _method.off >= maxLineLength()) {
+            return BAD_REQUEST;
+        }
+        break ;
+
+    case S_PROTOCOL:
+        if (c == ' ' || c == '\r' || c == '\n') {
+            _protocol.len = _pos - _protocol.off;
+            if (c == ' ') {
+                _state = S_SL_TAIL;
+            } else {
+                endLine(c);
+            }
+        } else if (_pos - _protocol.off > MAX_TOKEN_LENGTH) {
+            return BAD_REQUEST;
+        }
+        break ;
+
+    case S_SL_TAIL:
+        if (c == '\r' || c == '\n') {
+            endLine(c);
+        } else if (c != ' ') {
+            Log.debug() << "RequestParser:: Forbidden symbols at the end of the SL" << Log.endl;
+            return BAD_REQUEST;
+        } else if (_pos - _method.off >= maxLineLength()) {
+            return BAD_REQUEST;
+        }
+        break ;
+
+    case S_SL_LF:
+    case S_FIELD_LF:
+        if (c != '\n') {
+            return BAD_REQUEST;
+        }
+        _state = S_FIELD_START;
+        break ;
+
+    case S_FIELD_START:
+        if (c == '\r') {
+            _state = S_HEAD_LF;
+        } else if (c == '\n') {
+            _state = S_DONE;
+        } else if (c == ' ' || c == '\t' || c == ':') {
+            return BAD_REQUEST;
+        } else if (_nbFields == g_server->settings.max_header_fields) {
+            Log.debug() << "RequestParser:: Too many header fields" << Log.endl;
+            return REQUEST_HEADER_FIELDS_TOO_LARGE;
+        } else {
+            if (_nbFields == _fields.size()) {
+                _fields.push_back(Field());
+            }
+            _fields[_nbFields].name.off = _pos;
+            _state = S_NAME;
+        }
+        break ;
+
+    case S_NAME:
+        if (c == ':') {
+            _fields[_nbFields].name.len = _pos - _fields[_nbFields].name.off;
+            _fields[_nbFields].value.off = _pos + 1;
+            _fields[_nbFields].value.len = 0;
+            _state = S_OWS;
+        } else if (c == '\r' || c == '\n') {
+            Log.debug() << "RequestParser:: Invalid header" << Log.endl;
+            return BAD_REQUEST;
+        } else if (_pos - _fields[_nbFields].name.off >= max_field_length) {
+            return REQUEST_HEADER_FIELDS_TOO_LARGE;
+        }
+        break ;
+
+    case S_OWS:
+        if (c == '\r' || c == '\n') {
+            _nbFields++;
+            endLine(c);
+        } else if (c != ' ' && c != '\t') {
+            _fields[_nbFields].value.off = _pos;
+            _valueEnd = _pos + 1;
+            _state = S_VALUE;
+        } else if (_pos - _fields[_nbFields].value.off >= max_field_length) {
+            Log.debug() << "RequestParser:: Header is too large" << Log.endl;
+            return REQUEST_HEADER_FIELDS_TOO_LARGE;
+        }
+        break ;
+
+    // Trailing spaces are not a part of the value
+    case S_VALUE:
+        if (c == '\r' || c == '\n') {
+            _fields[_nbFields].value.len = _valueEnd - _fields[_nbFields].value.off;
+            _nbFields++;
+            endLine(c);
+        } else if (_pos - _fields[_nbFields].value.off >= max_field_length) {
+            Log.debug() << "RequestParser:: Header is too large" << Log.endl;
+            return REQUEST_HEADER_FIELDS_TOO_LARGE;
+        } else if (c != ' ' && c != '\t') {
+            _valueEnd = _pos + 1;
+        }
+        break ;
+
+    case S_HEAD_LF:
+        if (c != '\n') {
+            return BAD_REQUEST;
+        }
+        _state = S_DONE;
+        break ;
+
+    case S_DONE:
+        break ;
+    }
+    return CONTINUE;
+}
+
+// Lines could end with CRLF or with LF alone
+void
+RequestParser::endLine(char c) {
+    if (_state == S_VALUE || _state == S_OWS) {
+        _state = (c == '\r' ? S_FIELD_LF : S_FIELD_START);
+    } else {
+        _state = (c == '\r' ? S_SL_LF : S_FIELD_START);
+    }
+}
+
+// Length of the head with the empty line
+std::size_t
+RequestParser::length(void) const {
+    return _pos;
+}
+
+const RequestParser::Token &
+RequestParser::method(void) const {
+    return _method;
+}
+
+const RequestParser::Token &
+RequestParser::uri(void) const {
+    return _uri;
+}
+
+const RequestParser::Token &
+RequestParser::protocol(void) const {
+    return _protocol;
+}
+
+std::size_t
+RequestParser::fields(void) const {
+    return _nbFields;
+}
+
+const RequestParser::Field &
+RequestParser::field(std::size_t i) const {
+    return _fields[i];
+}
+
+} // namespace HTTP
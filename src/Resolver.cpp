@@ -0,0 +1,174 @@
+#include "Resolver.hpp"
+
+// Expired entries are swept only when cache grows over the limit
+#define WS_RESOLVER_CACHE_LIMIT 4096
+
+Resolver::Resolver(void)
+    : _running(false)
+    , _ttl(0) {
+
+    pthread_mutex_init(&_m_cache, NULL);
+    pthread_cond_init(&_c_lookups, NULL);
+    pthread_cond_init(&_c_done, NULL);
+}
+
+Resolver::~Resolver(void) {
+    stop();
+
+    pthread_cond_destroy(&_c_done);
+    pthread_cond_destroy(&_c_lookups);
+    pthread_mutex_destroy(&_m_cache);
+}
+
+int Resolver::start(std::time_t ttl) {
+
+    _ttl = ttl;
+    _running = true;
+    if (pthread_create(&_thread, NULL, _cycle, this)) {
+        Log.syserr() << "Resolver::pthread_create failed" << Log.endl;
+        _running = false;
+        return -1;
+    }
+    return 0;
+}
+
+void Resolver::stop(void) {
+
+    pthread_mutex_lock(&_m_cache);
+    if (!_running) {
+        pthread_mutex_unlock(&_m_cache);
+        return;
+    }
+    _running = false;
+    pthread_cond_broadcast(&_c_lookups);
+    pthread_cond_broadcast(&_c_done);
+    pthread_mutex_unlock(&_m_cache);
+
+    if (pthread_join(_thread, NULL)) {
+        Log.syserr() << "Resolver::pthread_join failed" << Log.endl;
+    }
+}
+
+// Returns true and sets name if address has been resolved.
+// Uncached address is queued for lookup, and caller waits
+// for it not more than waitMs; on timeout lookup goes on
+// in background and its result is cached for next calls.
+bool Resolver::resolve(const std::string &addr, std::string &name, long waitMs) {
+
+    struct timeval  now;
+    struct timespec deadline;
+
+    gettimeofday(&now, NULL);
+    deadline.tv_sec = now.tv_sec + waitMs / 1000;
+    deadline.tv_nsec = now.tv_usec * 1000 + (waitMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&_m_cache);
+
+    iter_cm it = _cache.find(addr);
+    if (it != _cache.end() && it->second.done && it->second.expires > Time::now()) {
+        Stats::inc(STAT_DNS_CACHE_HITS);
+    } else if (it == _cache.end() || it->second.done) {
+        if (_cache.size() >= WS_RESOLVER_CACHE_LIMIT) {
+            sweep(Time::now());
+        }
+
+        Entry &entry = _cache[addr];
+        entry.done = false;
+        entry.expires = 0;
+        _q_lookups.push(addr);
+        pthread_cond_signal(&_c_lookups);
+    }
+
+    bool resolved = false;
+    while (_running) {
+        it = _cache.find(addr);
+        if (it == _cache.end()) {
+            break;
+        }
+        if (it->second.done) {
+            name = it->second.name;
+            resolved = !name.empty();
+            break;
+        }
+        if (pthread_cond_timedwait(&_c_done, &_m_cache, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&_m_cache);
+
+    return resolved;
+}
+
+// Pending entries are kept, they are waited by someone
+void Resolver::sweep(std::time_t now) {
+
+    for (iter_cm it = _cache.begin(); it != _cache.end(); ) {
+        if (it->second.done && it->second.expires <= now) {
+            _cache.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// getnameinfo is thread-safe, unlike gethostbyaddr.
+// Empty string is returned if address has no name.
+std::string Resolver::lookup(const std::string &addr) {
+
+    struct sockaddr_in sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    if (inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) != 1) {
+        return "";
+    }
+
+    char host[NI_MAXHOST];
+    if (getnameinfo(reinterpret_cast<struct sockaddr *>(&sa), sizeof(sa),
+                    host, sizeof(host), NULL, 0, NI_NAMEREQD) != 0) {
+        return "";
+    }
+    return host;
+}
+
+void Resolver::loop(void) {
+
+    pthread_mutex_lock(&_m_cache);
+
+    while (_running) {
+        if (_q_lookups.empty()) {
+            pthread_cond_wait(&_c_lookups, &_m_cache);
+            continue ;
+        }
+
+        std::string addr = _q_lookups.front();
+        _q_lookups.pop();
+
+        pthread_mutex_unlock(&_m_cache);
+        std::string name = lookup(addr);
+        Stats::inc(STAT_DNS_LOOKUPS);
+        pthread_mutex_lock(&_m_cache);
+
+        Entry &entry = _cache[addr];
+        entry.name = name;
+        entry.expires = Time::now() + _ttl;
+        entry.done = true;
+        pthread_cond_broadcast(&_c_done);
+    }
+
+    pthread_mutex_unlock(&_m_cache);
+}
+
+void *
+Resolver::_cycle(void *ptr) {
+    Resolver *r = reinterpret_cast<Resolver *>(ptr);
+
+    Log.debug() << "Resolver::cycle started" << Log.endl;
+    r->loop();
+    Log.debug() << "Resolver::cycle stopped" << Log.endl;
+    return NULL;
+}
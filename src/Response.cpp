@@ -142,6 +142,47 @@ void Response::handle(void) {
     formed(true);
 }
 
+// Responses which need neither files nor gateways are cheap enough
+// to be built right on the loop thread, counter is set to their class.
+// Custom error pages are read from disk, so such errors go to workers.
+bool Response::isInline(StatsCounter &counter) {
+
+    if (getStatus() >= BAD_REQUEST) {
+        counter = STAT_INLINE_ERRORS;
+        return !hasErrorPage(getStatus());
+    }
+    if (getStatus() == NOT_MODIFIED) {
+        counter = STAT_INLINE_NOT_MODIFIED;
+        return true;
+    }
+    if (getStatus() >= MULTIPLE_CHOICES) {
+        return false;
+    }
+
+    if (!getRequest()->authorized()) {
+        counter = STAT_INLINE_AUTH;
+        return !hasErrorPage(getRequest()->isProxy() ? PROXY_AUTHENTICATION_REQUIRED : UNAUTHORIZED);
+    }
+    if (getClient()->isTunnel() || getRequest()->isProxy() || getRequest()->isCGI()) {
+        return false;
+    }
+    if (getRequest()->getLocation()->getRedirectRef().set()) {
+        counter = STAT_INLINE_REDIRECTS;
+        return true;
+    }
+
+    const std::string &method = getRequest()->getMethod();
+    if (method == "OPTIONS") {
+        counter = STAT_INLINE_OPTIONS;
+        return true;
+    }
+    if (method == "TRACE") {
+        counter = STAT_INLINE_TRACE;
+        return true;
+    }
+    return false;
+}
+
 void Response::makeResponseForNonAuth(void) {
 
     if (getRequest()->isProxy()) {
@@ -160,7 +201,7 @@ void Response::makeResponseForNonAuth(void) {
 void Response::DELETE(void) {
     std::string resourcePath = _req->getResolvedPath();
 
-    if (!resourceExists(resourcePath)) {
+    if (!resourceExists(resourcePath) || isUploadFile(resourcePath)) {
         setStatus(NOT_FOUND);
         return;
     } else if (isDirectory(resourcePath)) {
@@ -235,7 +276,9 @@ void Response::PATCH(void) {
 
 bool
 Response::writeBodyToFile(const std::string &resourcePath) {
-    if (getRequest()->getFileFd() != -1) {
+    if (getRequest()->uploading()) {
+        return getRequest()->moveUploadFile(resourcePath);
+    } else if (getRequest()->getFileFd() != -1) {
         if (std::rename(getRequest()->getFilename().c_str(), resourcePath.c_str())) {
             Log.syserr() << "Cannot move tmp file " << _filename << Log.endl;
             return false;
@@ -329,7 +372,7 @@ int Response::makeResponseForDir(void) {
 int Response::contentForGetHead(void) {
     const std::string &resourcePath = _req->getResolvedPath();
 
-    if (!resourceExists(resourcePath)) {
+    if (!resourceExists(resourcePath) || isUploadFile(resourcePath)) {
         setStatus(NOT_FOUND);
         return 0;
     }
@@ -378,12 +421,14 @@ int Response::makeResponseForFile(void) {
         return 0;
     }
 
-    if (!mapFile()) {
-        Log.error() << "Response:: Cannot map file " << resourcePath << Log.endl; 
+    if (!statFile()) {
+        Log.error() << "Response:: Cannot stat file " << resourcePath << Log.endl; 
         setStatus(INTERNAL_SERVER_ERROR);
         return 0;
     }
 
+    // File isn't mapped: whole file, ranges and chunks
+    // are sent by sendfile() right from the page cache
     RangeList &ranges = getRequest()->getRangeList();
     if (ranges.size() == 1) {
         if (!makeResponseForRange()) {
@@ -395,12 +440,10 @@ int Response::makeResponseForFile(void) {
             setStatus(RANGE_NOT_SATISFIABLE);
             return 0;
         }
+    } else if (static_cast<uint64_t>(getFileSize()) > g_server->settings.max_reg_file_size) {
+        chunked(true);
     } else {
-        if (static_cast<uint64_t>(getRealBodySize()) > g_server->settings.max_reg_file_size) {
-            chunked(true);
-        } else {
-            setBody(std::string(_fileaddr, getFileSize()));
-        }
+        setFileBody(0, getFileSize());
     }
 
     addHeader(CONTENT_TYPE, getContentType(resourcePath));
@@ -434,34 +477,37 @@ Response::makeResponseForMultipartRange(void) {
     const std::string &path = getRequest()->getResolvedPath();
     RangeList         &ranges = getRequest()->getRangeList();
 
-    std::stringstream ss;
-
     const std::string &sepPrefix = "--";
     const std::string &boundary = Base64::encode(SHA1().hash(itos(std::rand())));
+    const std::string &type = getContentType(path);
 
+    // Part headers are frames, data of parts is never copied
+    setBody("");
+
+    std::string frame;
     RangeList::iterator range = ranges.begin();
     for (range = ranges.begin(); range != ranges.end(); ++range) {
         range->narrow(g_server->settings.max_range_size);
         range->rlimit(getFileSize() - 1);
 
+        // Range should not be included if invalid
         if (range->beg > getFileSize()) {
             continue ;
         }
 
-        // Range should not be included if invalid
-        ss << sepPrefix << boundary << CRLF;
-        ss << headerNames[CONTENT_TYPE] << ":" << getContentType(path) << CRLF;
-        ss << headerNames[CONTENT_RANGE] << ":" << getContentRangeValue(*range) << CRLF;
-        ss.write(_fileaddr + range->beg, range->size() - 1);
-        ss << CRLF;
+        frame += sepPrefix + boundary + CRLF;
+        frame += headerNames[CONTENT_TYPE] + ": " + type + CRLF;
+        frame += headerNames[CONTENT_RANGE] + ": " + getContentRangeValue(*range) + CRLF CRLF;
+        addFilePart(frame, range->beg, range->size());
+        frame = CRLF;
     }
-    ss << sepPrefix << boundary << sepPrefix << CRLF;
+    frame += sepPrefix + boundary + sepPrefix + CRLF;
+    addFilePart(frame, 0, 0);
 
     Log.debug() << "Multipart range processed" << Log.endl;
 
     setStatus(PARTIAL_CONTENT);
     addHeader(CONTENT_TYPE, "multipart/byteranges; boundary=" + boundary);
-    setBody(ss.str());
 
     return 1;
 }
@@ -480,7 +526,7 @@ int Response::makeResponseForRange(void) {
 
     setStatus(PARTIAL_CONTENT);
     addHeader(CONTENT_RANGE);
-    setBody(std::string(_fileaddr + range.beg, range.size()));
+    setFileBody(range.beg, range.size());
 
     return 1;
 }
@@ -594,7 +640,7 @@ int Response::listing(const std::string &resourcePath) {
     std::sort(filenames.begin(), filenames.end());
     std::deque<std::string>::iterator it;
     for (it = filenames.begin(); it != filenames.end(); ++it) {
-        if (*it == "." || *it == "..") {
+        if (*it == "." || *it == ".." || isUploadFile(*it)) {
             continue;
         }
         body += createTableLine(*it);
@@ -733,6 +779,14 @@ int Response::makeResponseForCGI(void) {
     return 1;
 }
 
+bool Response::hasErrorPage(StatusCode code) {
+    if (getRequest()->getLocation() == NULL) {
+        return false;
+    }
+    std::map<int, std::string> &pages = getRequest()->getLocation()->getErrorPagesRef();
+    return pages.find(code) != pages.end();
+}
+
 void Response::makeResponseForError(void) {
     if (getRequest()->getLocation() != NULL) {
         std::map<int, std::string>          &pages = getRequest()->getLocation()->getErrorPagesRef();
@@ -839,11 +893,12 @@ bool Response::parseLine(std::string &line) {
             setStatus(SEE_OTHER);
         }
 
+        // Body kept in the file is sent as a file range (or chunks)
         if (getFileFd() != -1) {
-            if (!mapFile()) {
+            if (!statFile()) {
                 setStatus(INTERNAL_SERVER_ERROR);
             } else if (!chunked()) {
-                parted(true);
+                setFileBody(0, getRealBodySize());
             }
         }
 
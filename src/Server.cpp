@@ -1,18 +1,14 @@
 #include "Server.hpp"
 
-const std::size_t reservedClients = 64;
-
 Server::Server()
     : _working(true)
+    , _reactors(NULL)
+    , _staticPool(NULL)
+    , _cgiPool(NULL)
+    , _proxyPool(NULL)
+    , _printStats(0)
     , isDaemon(false) {
-    _pollfds.reserve(reservedClients);
-
-    pthread_mutex_init(&_m_new_resp, NULL);
-    pthread_mutex_init(&_m_new_pfds, NULL);
-    pthread_mutex_init(&_m_new_clnt, NULL);
-    pthread_mutex_init(&_m_del_pfds, NULL);
-    pthread_mutex_init(&_m_del_clnt, NULL);
-    pthread_mutex_init(&_m_link, NULL);
+
     pthread_mutex_init(&_m_sessions, NULL);
 
     HTTP::ETag::StaticConstructor();
@@ -20,22 +16,10 @@ Server::Server()
 
 Server::~Server(void) {
 
-    for (iter_cv it = _clients.begin(); it != _clients.end(); ++it) {
-        if (*it != NULL) {
-            delete *it;
-        }
-    }
-
-    for (size_t i = 0; i < _sockets.size(); ++i) {
-        delete _sockets[i];
+    if (_reactors != NULL) {
+        delete[] _reactors;
     }
 
-    pthread_mutex_destroy(&_m_new_resp);
-    pthread_mutex_destroy(&_m_new_pfds);
-    pthread_mutex_destroy(&_m_new_clnt);
-    pthread_mutex_destroy(&_m_del_pfds);
-    pthread_mutex_destroy(&_m_del_clnt);
-    pthread_mutex_destroy(&_m_link);
     pthread_mutex_destroy(&_m_sessions);
 
     HTTP::ETag::StaticDestructor();
@@ -53,9 +37,6 @@ Server &
 Server::operator=(const Server &other) {
     if (this != &other) {
         _servers = other._servers;
-        _pollfds = other._pollfds;
-        _clients = other._clients;
-        _sockets = other._sockets;
     }
     return (*this);
 }
@@ -85,11 +66,33 @@ sigint_handler(int) {
     g_server->finish();
 }
 
+static void
+sigusr1_handler(int) {
+    g_server->printStats();
+}
+
+// Stats are printed by the event loop, not by the handler itself
+void Server::printStats(void) {
+    _printStats = 1;
+}
+
 bool
 Server::isServerHostname(const std::string &name) {
     return (_hostnames.find(name) != _hostnames.end());
 }
 
+// Name is resolved only on demand and only if reverse_dns is on,
+// otherwise (or if lookup takes too long) address is returned
+std::string
+Server::remoteHost(const std::string &addr) {
+
+    std::string name;
+    if (settings.reverse_dns && _resolver.resolve(addr, name, 100)) {
+        return name;
+    }
+    return addr;
+}
+
 int
 Server::initHostnamesSet(void) {
 
@@ -175,8 +178,16 @@ void Server::start(void) {
     }
 
     signal(SIGINT, sigint_handler);
+    signal(SIGUSR1, sigusr1_handler);
     
     initHostnamesSet();
+    if (Affinity::init(settings.reactors, settings.reactor_cpus, settings.worker_cpus) < 0) {
+        finish();
+        return;
+    }
+    if (createReactors() < 0) {
+        return;
+    }
     createSockets();
     if (!working()) {
         return;
@@ -186,45 +197,77 @@ void Server::start(void) {
         Log.debug() << *it << Log.endl;
     }
 
-    startWorkers();
+    Stats::init();
+    if (settings.reverse_dns && _resolver.start(settings.reverse_dns_ttl) < 0) {
+        settings.reverse_dns = false;
+    }
+    if (startWorkers() < 0) {
+        stopWorkers();
+        return;
+    }
+    startReactors();
+
+    // Reactors do all networking, main thread
+    // only takes care of server-wide housekeeping
     while (working()) {
-        emptyNewClientQ();
-        emptyNewFdsQ();
-    
-        if (poll() > 0) {
-            process();
-        }
-        checkTimeout();
         checkSessionsTimeout();
-    
-        emptyDelFdsQ();
-        emptyDelClientQ();
+
+        if (_printStats) {
+            _printStats = 0;
+            Stats::print();
+            printPoolsStats();
+        }
+        sleep(1);
     }
+
+    stopReactors();
+    printPoolsStats();
     stopWorkers();
+    _resolver.stop();
+    Stats::print();
 }
 
-int Server::addListenSocket(const std::string &addr, std::size_t port) {
-    IO *sock = new IO();
-    if (sock == NULL) {
-        Log.syserr() << "Server:: Cannot allocate memory for IO" << Log.endl;
-        return -1;
+int Server::createReactors(void) {
+
+    if (settings.edge_triggered && settings.event_engine != "epoll") {
+        Log.error() << "Server:: edge-triggered mode requires epoll, level-triggered is used" << Log.endl;
+        settings.edge_triggered = false;
     }
 
-    if (sock->socket() < 0) {
-        delete sock;
+    _reactors = new Reactor[settings.reactors];
+    if (_reactors == NULL) {
+        Log.syserr() << "Cannot allocate memory for reactors" << Log.endl;
+        finish();
         return -1;
     }
 
-    if (sock->listen(addr, port) < 0) {
-        delete sock;
-        return -1;
+    for (std::size_t i = 0; i < Reactor::count; i++) {
+        if (_reactors[i].init() < 0) {
+            finish();
+            return -1;
+        }
     }
-    _pollfds.push_back((struct pollfd){sock->rdFd(), POLLIN, 0});
-    _sockets.push_back(sock);
 
+    Log.info() << "Event engine: " << settings.event_engine << (settings.edge_triggered ? " (edge-triggered)" : "")
+               << ", reactors: " << Reactor::count << Log.endl;
     return 0;
 }
 
+void Server::startReactors(void) {
+
+    for (std::size_t i = 0; i < Reactor::count; i++) {
+        _reactors[i].create();
+    }
+}
+
+void Server::stopReactors(void) {
+
+    for (std::size_t i = 0; i < Reactor::count; i++) {
+        _reactors[i].wakeup();
+        _reactors[i].join();
+    }
+}
+
 void Server::createSockets(void) {
     typedef std::set<std::string> uniqueAddr;
     typedef uniqueAddr::iterator  iter_ua;
@@ -249,227 +292,98 @@ void Server::createSockets(void) {
         for (iter_ua ua = it->second.begin(); ua != it->second.end(); ++ua) {
             const std::size_t  port = it->first;
             const std::string &addr = *ua;
-            if (addListenSocket(addr, port) < 0) {
-                finish();
-                return;
+            // Every reactor has its own listening socket
+            for (std::size_t i = 0; i < Reactor::count; i++) {
+                if (_reactors[i].addListenSocket(addr, port) < 0) {
+                    finish();
+                    return;
+                }
             }
         }
     }
 }
 
-void Server::startWorkers(void) {
-
-    _workers = new Worker[settings.workers];
-    
-    if (_workers == NULL) {
-        Log.syserr() << "Cannot allocate memory for workers" << Log.endl;
-        return;
-    }
+// Every pool from worker_pools is started, the ones for
+// static files, CGI and proxy always exist
+int Server::startWorkers(void) {
 
-    for (std::size_t i = 0; i < Worker::count; i++) {
-        _workers[i].create();
-    }
-}
+    typedef Settings::WorkerPoolsMap::const_iterator iter_wps;
 
-void Server::stopWorkers(void) {
-
-    for (std::size_t i = 0; i < Worker::count; i++) {
-        _workers[i].join();
-    }
-
-    delete[] _workers;
-    _workers = NULL;
-}
-
-void
-Server::pollin(int fd) {
-
-    size_t id = _connector[fd];
-
-    if (id < 0 || id >= _clients.size()) {
-        Log.debug() << "Server::pollin:: invalid id: " << fd << " " << id << Log.endl;
-        return ;
-    }
-
-    HTTP::Client *client = _clients[id];
-    if (client == NULL) {
-        return ;
+    for (iter_wps it = settings.worker_pools.begin(); it != settings.worker_pools.end(); ++it) {
+        WorkerPool *pool = new WorkerPool();
+        if (pool == NULL) {
+            Log.syserr() << "Cannot allocate memory for worker pool " << it->first << Log.endl;
+            return -1;
+        }
+        _pools[it->first] = pool;
+        if (pool->init(it->first, it->second) < 0) {
+            return -1;
+        }
     }
 
-    if (fd == client->getClientIO()->rdFd()) {
-        client->tryReceiveRequest(fd);
+    _staticPool = _pools[WORKER_POOL_STATIC];
+    _cgiPool = _pools[WORKER_POOL_CGI];
+    _proxyPool = _pools[WORKER_POOL_PROXY];
 
-    } else if (fd == client->getGatewayIO()->rdFd()) {
-        client->tryReceiveResponse(fd);
+    for (iter_wpm it = _pools.begin(); it != _pools.end(); ++it) {
+        it->second->start();
     }
+    return 0;
 }
 
-void
-Server::pollout(int fd) {
-
-    size_t id = _connector[fd];
-
-    if (id < 0 || id >= _clients.size()) {
-        Log.debug() << "Server::pollout:: invalid id: " << fd << " " << id << Log.endl;
-        return ;
-    }
-
-    HTTP::Client *client = _clients[id];
-    if (client == NULL) {
-        return ;
-    }
-
-    if (fd == client->getClientIO()->wrFd()) {
-        client->tryReplyResponse(fd);
+void Server::stopWorkers(void) {
 
-    } else if (fd == client->getGatewayIO()->wrFd()) {
-        client->tryReplyRequest(fd); 
+    for (iter_wpm it = _pools.begin(); it != _pools.end(); ++it) {
+        it->second->stop();
+        delete it->second;
     }
+    _pools.clear();
 }
 
-void
-Server::pollhup(int fd) {
-
-    Log.syserr() << "Server::pollhup [" << fd << "]" << Log.endl;
+void Server::printPoolsStats(void) {
 
-    size_t id = _connector[fd];
-
-    if (id < 0 || id >= _clients.size()) {
-        Log.debug() << "Server::pollhup:: invalid id: " << id << Log.endl;
-    }
-
-    HTTP::Client *client = _clients[id];
-    if (client == NULL) {
-        return ;
+    for (iter_wpm it = _pools.begin(); it != _pools.end(); ++it) {
+        it->second->print();
     }
-
-    if (fd == client->getClientIO()->rdFd()) {
-        unlink(fd);
-
-    } else if (fd == client->getGatewayIO()->wrFd()) {
-        unlink(fd);
-
-    } else if (fd == client->getGatewayIO()->rdFd()) {
-        client->tryReceiveResponse(fd);
-        unlink(fd);
-    }    
 }
 
+// Session timer keeps the pointer to its id
 void
-Server::pollerr(int fd) {
-    Log.syserr() << "Server::pollerr [" << fd << "]" << Log.endl;
+Server::checkSessionsTimeout(void) {
 
-    size_t id = _connector[fd];
+    TimerWheel::TimersVec expired;
 
-    if (id < 0 || id >= _clients.size()) {
-        Log.debug() << "Server::pollerr:: invalid id: " << id << Log.endl;
-    }
+    pthread_mutex_lock(&_m_sessions);
 
-    HTTP::Client *client = _clients[id];
-    if (client == NULL) {
-        return ;
+    _sessionTimers.advance(Time::now(), expired);
+    for (std::size_t i = 0; i < expired.size(); ++i) {
+        const std::string s_id = *static_cast<const std::string *>(expired[i]->data);
+        _sessions.erase(s_id);
     }
 
-    if (fd == client->getClientIO()->rdFd()) {
-        unlink(fd);
-
-    } else if (fd == client->getGatewayIO()->wrFd()) {
-        unlink(fd);
-
-    } else if (fd == client->getGatewayIO()->rdFd()) {
-        unlink(fd);
-    } 
+    pthread_mutex_unlock(&_m_sessions);
 }
 
+bool
+Server::isActualSession(const std::string &s_id) {
 
+    bool actual = false;
 
-void Server::process(void) {
-
-    for (std::size_t id = 0; id < _pollfds.size(); id++) {
-
-        const int fd = _pollfds[id].fd;
-
-        if (fd < 0 || _pollfds[id].revents & POLLNVAL) {
-            continue ;
-        }
+    pthread_mutex_lock(&_m_sessions);
 
-        if (id < _sockets.size()) {
-            if (_pollfds[id].revents & POLLIN) {
-                connect(id, fd);
-            }
+    iter_ssm it = _sessions.find(s_id);
+    if (it != _sessions.end()) {
+        if (Time::now() < it->second.expires) {
+            actual = true;
         } else {
-            if (_pollfds[id].revents & POLLIN) {
-                pollin(fd);
-            } else if (_pollfds[id].revents & POLLHUP) {
-                pollhup(fd);
-            } else if (_pollfds[id].revents & POLLOUT) {
-                pollout(fd);
-            } else if (_pollfds[id].revents & POLLERR) {
-                pollerr(fd);
-            }
-        }
-        _pollfds[id].revents = 0;
-    }
-}
-
-int Server::poll(void) {
-    int res = ::poll(_pollfds.data(), _pollfds.size(), 100000);
-
-    if (res < 0) {
-        if (working()) {
-            Log.syserr() << "Server::poll" << Log.endl;
+            _sessionTimers.remove(&it->second);
+            _sessions.erase(it);
         }
     }
-    return res;
-}
-
-static int
-isFdFree(struct pollfd pfd) {
-    return (pfd.fd == -1);
-}
-
-static int
-isClientFree(HTTP::Client *client) {
-    return (client == NULL);
-}
-
-void
-Server::checkTimeout(void) {
-
-    for (ClientsVec::iterator it = _clients.begin(); it != _clients.end(); ++it) {
-        
-        HTTP::Client *client = *it;
-        if (client == NULL) {
-            continue ;
-        }
-
-        client->checkTimeout();
 
-        if (client->links == 0 && !client->processing()) {
-            *it = NULL;
-            addToDelClientQ(client);
-        }
-    }
-}
-
-void
-Server::checkSessionsTimeout(void) {
+    pthread_mutex_unlock(&_m_sessions);
 
-    for (SessionsMap::iterator it = _sessions.begin(); it != _sessions.end();) {
-        isActualSession((it++)->first);
-    }
-}
-
-bool
-Server::isActualSession(const std::string &s_id) {
-    if (_sessions.find(s_id) != _sessions.end()) {
-        std::time_t current = Time::now();
-        if (current - _sessions[s_id] < settings.session_lifetime) {
-            return true;
-        }
-        _sessions.erase(s_id);
-    }
-    return false;
+    return actual;
 }
 
 void
@@ -477,300 +391,34 @@ Server::addSession(const std::string s_id) {
 
     pthread_mutex_lock(&_m_sessions);
 
-    _sessions[s_id] = Time::now();
+    iter_ssm it = _sessions.insert(std::make_pair(s_id, Timer())).first;
+    it->second.data = const_cast<std::string *>(&it->first);
+    _sessionTimers.add(&it->second, Time::now() + settings.session_lifetime);
 
     pthread_mutex_unlock(&_m_sessions);
 }
 
-void
-Server::addClient(HTTP::Client *client) {
+// Location could name its own pool, otherwise
+// responses are split by the class of their handler
+WorkerPool *Server::choosePool(HTTP::Response *res) {
 
-    iter_cv it = std::find_if(_clients.begin(), _clients.end(), isClientFree);
-    if (it == _clients.end()) {
-        it = _clients.insert(_clients.end(), client);
-    }
-     
-    *it = client;
-
-    size_t id = std::distance(_clients.begin(), it);
-
-    client->setId(id);
-}
-
-void
-Server::link(int fd, HTTP::Client *client) {
-
-    pthread_mutex_lock(&_m_link);
-
-    _connector[fd] = client->getId();
-    client->links++;
-    
-    addToNewFdsQ(fd);
-
-    pthread_mutex_unlock(&_m_link);
-}
-
-void
-Server::unlink(int fd) {
-
-    pthread_mutex_lock(&_m_link);
-
-    int id = _connector[fd];
-
-    if (id < 0) {
-        pthread_mutex_unlock(&_m_link);
-        return ;
-    }
-
-    HTTP::Client *client = _clients[id];
-    if (client == NULL) {
-        pthread_mutex_unlock(&_m_link);
-        return ;
-    }
-
-    if (fd >= 0) {
-        close(fd);
-    }
-
-    _connector[fd] = -1;
-    client->links--;
-
-    addToDelFdsQ(fd);
-
-    pthread_mutex_unlock(&_m_link);
-}
-
-void Server::connect(std::size_t servid, int servfd) {
-    struct sockaddr_in servData;
-    socklen_t          servLen = sizeof(servData);
-    if (getsockname(servfd, (struct sockaddr *)&servData, &servLen) < 0) {
-        Log.syserr() << "Server::getsockname [" << servfd << "]" << Log.endl;
-        return;
-    }
-
-    struct sockaddr_in clientData;
-    socklen_t          clientLen = sizeof(clientData);
-    
-    int fd = accept(servfd, (struct sockaddr *)&clientData, &clientLen);
-    if (fd < 0) {
-        Log.syserr() << "Server::accept" << Log.endl;
-        return;
-    }
-
-    HTTP::Client *client = new HTTP::Client();
-    if (client == NULL) {
-        Log.syserr() << "Server::Cannot allocate memory for Client" << Log.endl;
-        close(fd);
-        return ;
-    }
-
-    struct hostent *he = NULL;
-    he = gethostbyaddr(&clientData.sin_addr, sizeof(clientData.sin_addr), AF_INET);
-    if (he != NULL && he->h_name != NULL) {
-        client->setDomainName(he->h_name);
-    }
-
-    client->setServerIO(_sockets[servid]);
-    client->setClientTimeout(Time::now());
-    client->getClientIO()->rdFd(fd);
-    client->getClientIO()->wrFd(fd);
-    client->getClientIO()->nonblock();
-    client->getClientIO()->setAddr(inet_ntoa(clientData.sin_addr));
-    client->getClientIO()->setPort(ntohs(clientData.sin_port));
-
-    addClient(client);
-    link(fd, client);
-
-    Log.debug() << "Server::connect [" << fd << "] -> " << client->getHostname() << Log.endl;
-}
-
-// The functions below used to work with different queues
-
-void Server::addToNewFdsQ(int fd) {
-
-    if (fd < 0) {
-        return ;
-    }
-
-    pthread_mutex_lock(&_m_new_pfds);
-
-    Log.debug() << "Server::addToNewFdsQ [" << fd << "]" << Log.endl;
-    _q_newPfds.push(fd);
-
-    pthread_mutex_unlock(&_m_new_pfds);
-}
-
-void Server::addToNewClientQ(int fd, HTTP::Client *client) {
-
-    pthread_mutex_lock(&_m_new_clnt);
-
-    Log.debug() << "Server::addToNewClientQ [" << fd << "]" << Log.endl;
-    _q_newClients.push(std::make_pair(fd, client));
-
-    pthread_mutex_unlock(&_m_new_clnt);
-}
-
-void Server::addToDelFdsQ(int fd) {
-
-    if (fd < 0) {
-        return ;
-    }
-
-    pthread_mutex_lock(&_m_del_pfds);
-
-    bool inserted = _q_delPfds.insert(fd).second;
-    if (inserted) {
-        Log.debug() << "Server::addToDelFdsQ [" << fd << "]" << Log.endl;
-    }
-
-    pthread_mutex_unlock(&_m_del_pfds);
-}
-
-void Server::addToDelClientQ(HTTP::Client *client) {
-
-    pthread_mutex_lock(&_m_del_clnt);
-
-    if (client != NULL) {
-        bool inserted = _q_delClients.insert(client).second;
-        if (inserted) {
-            Log.debug() << "Server::addToDelClientQ -> " << client << Log.endl;
-        }
-    }
-
-    pthread_mutex_unlock(&_m_del_clnt);
-}
-
-void Server::emptyNewFdsQ(void) {
-
-    pthread_mutex_lock(&_m_new_pfds);
-
-    while (!_q_newPfds.empty()) {
-
-        int tmpfd = _q_newPfds.front();
-        _q_newPfds.pop();
-
-        struct pollfd tmp = { tmpfd, POLLIN | POLLOUT, 0 };
-
-        iter_pfd it = std::find_if(_pollfds.begin(), _pollfds.end(), isFdFree);
-        if (it == _pollfds.end()) {
-            _pollfds.push_back(tmp);
-        } else {
-            *it = tmp;
+    HTTP::Request *req = res->getRequest();
+    if (req->getLocation() != NULL && !req->getLocation()->getWorkerPoolRef().empty()) {
+        iter_wpm it = _pools.find(req->getLocation()->getWorkerPoolRef());
+        if (it != _pools.end()) {
+            return it->second;
         }
-
-        Log.debug() << "Server::emptyNewFdsQ [" << tmp.fd << "]" << Log.endl;
-    }
-
-    pthread_mutex_unlock(&_m_new_pfds);
-}
-
-void Server::emptyDelFdsQ(void) {
-    pthread_mutex_lock(&_m_del_pfds);
-
-    while (_q_delPfds.begin() != _q_delPfds.end()) {
-
-        std::set<int>::iterator beg = _q_delPfds.begin();
-        int tmpfd = *beg;
-        _q_delPfds.erase(beg);
-
-        if (tmpfd == -1) {
-            continue;
-        }
- 
-        struct pollfd tmp = { -1, 0, 0 };
-
-        for (size_t i = 0; i < _pollfds.size(); ++i) {
-            if (_pollfds[i].fd == tmpfd) {
-                _pollfds[i] = tmp;
-                break ;
-            }
-        }
-
-        Log.debug() << "Server::emptyDelFdsQ [" << tmpfd << "]" << Log.endl;
-    }
-
-    pthread_mutex_unlock(&_m_del_pfds);
-}
-
-void Server::emptyNewClientQ(void) {
-    pthread_mutex_lock(&_m_new_clnt);
-
-    while (!_q_newClients.empty()) {
-        std::pair<int, HTTP::Client *> tmp = _q_newClients.front();
-        _q_newClients.pop();
-
-        _clients[tmp.first] = tmp.second;
-    
-        Log.debug() << "Server::emptyNewClientQ [" << tmp.first << "]" << Log.endl;
     }
 
-    pthread_mutex_unlock(&_m_new_clnt);
-}
-
-void Server::emptyDelClientQ(void) {
-
-    pthread_mutex_lock(&_m_del_clnt);
-
-    while (_q_delClients.begin() != _q_delClients.end()) {
-
-        std::set<HTTP::Client *>::iterator beg = _q_delClients.begin();
-        HTTP::Client *client = *beg;
-        _q_delClients.erase(beg);
-
-        rmClientFromRespQ(client);
-
-        _clients[client->getId()] = NULL;
-
-        Log.debug() << "Server::emptyDelClientQ -> " << client << Log.endl;
-
-        delete client;
+    if (res->getClient()->isTunnel() || req->isProxy()) {
+        return _proxyPool;
+    } else if (req->isCGI()) {
+        return _cgiPool;
     }
-
-    pthread_mutex_unlock(&_m_del_clnt);
+    return _staticPool;
 }
 
-void Server::rmClientFromRespQ(HTTP::Client *client) {
-
-    pthread_mutex_lock(&_m_new_resp);
-        
-    std::list<HTTP::Response *>::iterator it;
-    for (it = _q_newResponses.begin(); it != _q_newResponses.end(); ) {
-        if (*it != NULL && (*it)->getClient() == client) {
-            it = _q_newResponses.erase(it);
-        } else {
-            ++it;
-        }
-    }
-
-    pthread_mutex_unlock(&_m_new_resp);
-}
-
-void Server::addToRespQ(HTTP::Response *res) {
-
-    pthread_mutex_lock(&_m_new_resp);
-
-    _q_newResponses.push_back(res);
-    
-    pthread_mutex_unlock(&_m_new_resp);
-}
-
-HTTP::Response *Server::rmFromRespQ(void) {
-
-    HTTP::Response *res = NULL;
-
-    pthread_mutex_lock(&_m_new_resp);
-
-    if (_q_newResponses.begin() != _q_newResponses.end()) {
-        res = _q_newResponses.front();
-        _q_newResponses.pop_front();
-        if (res->getClient()->links == 0) {
-            res = NULL;
-        } else {
-            res->getClient()->processing(true);
-        }
-    }
-
-    pthread_mutex_unlock(&_m_new_resp);
-
-    return res;
+// Returns false if the queue of the pool is full
+bool Server::addToRespQ(HTTP::Response *res) {
+    return choosePool(res)->push(res);
 }
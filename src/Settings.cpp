@@ -3,16 +3,38 @@
 Settings::Settings(void) {
 
     max_wait_conn = 128;
+    accept_budget = 64;
+
+#ifdef __linux__
+    event_engine = "epoll";
+#else
+    event_engine = "poll";
+#endif
+    edge_triggered = false;
+    reactors = 1;
+
     workers = 3;
-    worker_timeout = 10000;
+    max_workers = 0;
+    worker_timeout = 1000000;
+    worker_distribution = "round_robin";
+    worker_grow_wait = 5000;
+    worker_grow_depth = 4;
+    worker_idle_timeout = 30;
+
+    reactor_cpus = "";
+    worker_cpus = "";
     
     max_requests = 100;
     max_client_timeout = 100;
     max_gateway_timeout = 25;
     session_lifetime = 86400; // 1 Day
+
+    reverse_dns = false;
+    reverse_dns_ttl = 300;
     
     max_uri_length = 1024;
     max_header_field_length = 2048;
+    max_header_fields = 64;
 
     blind_proxy = false;
     cookie_httpOnly = true;
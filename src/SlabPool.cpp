@@ -0,0 +1,160 @@
+#include "SlabPool.hpp"
+
+// Slabs kept for reuse in the shared lists, of each size
+static const std::size_t MAX_POOLED = 1024;
+
+// Slabs kept by a thread of each size, and how many of them
+// are moved at once between the thread and the shared lists
+static const std::size_t MAX_CACHED = 32;
+static const std::size_t BATCH = MAX_CACHED / 2;
+
+SlabPool::FreeList  SlabPool::_shared[2] = { { NULL, 0 }, { NULL, 0 } };
+pthread_mutex_t     SlabPool::_m_slabs = PTHREAD_MUTEX_INITIALIZER;
+pthread_key_t       SlabPool::_k_cache;
+pthread_once_t      SlabPool::_once = PTHREAD_ONCE_INIT;
+
+static int
+kindOf(std::size_t size) {
+    return (size == SlabPool::SMALL ? 0 : 1);
+}
+
+static std::size_t
+sizeOf(int kind) {
+    return (kind == 0 ? SlabPool::SMALL : SlabPool::LARGE);
+}
+
+// Size is SMALL or LARGE. Returns NULL if allocation failed.
+char *
+SlabPool::get(std::size_t size) {
+
+    Cache *local = cache();
+    char *slab = NULL;
+
+    if (local != NULL) {
+        FreeList &list = local->lists[kindOf(size)];
+        if (list.head == NULL) {
+            refill(list, kindOf(size));
+        }
+        slab = pop(list);
+    }
+
+    if (slab != NULL) {
+        Stats::addLocal(STAT_POOLED_BUFFER_BYTES, -static_cast<long>(size));
+    } else {
+        slab = new char[size];
+        if (slab == NULL) {
+            return NULL;
+        }
+    }
+
+    Stats::addLocal(STAT_READ_BUFFER_BYTES, size);
+    return slab;
+}
+
+void
+SlabPool::put(char *slab, std::size_t size) {
+
+    Stats::addLocal(STAT_READ_BUFFER_BYTES, -static_cast<long>(size));
+
+    Cache *local = cache();
+    if (local == NULL) {
+        delete[] slab;
+        return ;
+    }
+
+    FreeList &list = local->lists[kindOf(size)];
+    if (list.nb == MAX_CACHED) {
+        spill(list, kindOf(size), BATCH);
+    }
+    push(list, slab);
+    Stats::addLocal(STAT_POOLED_BUFFER_BYTES, size);
+}
+
+// Lists of the calling thread, made on the first use
+SlabPool::Cache *
+SlabPool::cache(void) {
+
+    pthread_once(&_once, createKey);
+
+    Cache *local = static_cast<Cache *>(pthread_getspecific(_k_cache));
+    if (local == NULL) {
+        local = new Cache();
+        if (pthread_setspecific(_k_cache, local) != 0) {
+            delete local;
+            return NULL;
+        }
+    }
+    return local;
+}
+
+void
+SlabPool::createKey(void) {
+    pthread_key_create(&_k_cache, releaseCache);
+}
+
+// Slabs of the exiting thread (a retired worker) go to the shared lists
+void
+SlabPool::releaseCache(void *ptr) {
+
+    Cache *local = static_cast<Cache *>(ptr);
+    for (int kind = 0; kind < 2; ++kind) {
+        spill(local->lists[kind], kind, local->lists[kind].nb);
+    }
+    delete local;
+}
+
+void
+SlabPool::push(FreeList &list, char *slab) {
+    FreeSlab *free = reinterpret_cast<FreeSlab *>(slab);
+    free->next = list.head;
+    list.head = free;
+    ++list.nb;
+}
+
+char *
+SlabPool::pop(FreeList &list) {
+    if (list.head == NULL) {
+        return NULL;
+    }
+    char *slab = reinterpret_cast<char *>(list.head);
+    list.head = list.head->next;
+    --list.nb;
+    return slab;
+}
+
+void
+SlabPool::refill(FreeList &list, int kind) {
+
+    pthread_mutex_lock(&_m_slabs);
+    for (std::size_t i = 0; i < BATCH && _shared[kind].head != NULL; ++i) {
+        push(list, pop(_shared[kind]));
+    }
+    pthread_mutex_unlock(&_m_slabs);
+}
+
+// Slabs which don't fit the shared list are freed
+void
+SlabPool::spill(FreeList &list, int kind, std::size_t count) {
+
+    FreeSlab *extra = NULL;
+
+    pthread_mutex_lock(&_m_slabs);
+    for (std::size_t i = 0; i < count && list.head != NULL; ++i) {
+        char *slab = pop(list);
+        if (_shared[kind].nb < MAX_POOLED) {
+            push(_shared[kind], slab);
+        } else {
+            FreeSlab *free = reinterpret_cast<FreeSlab *>(slab);
+            free->next = extra;
+            extra = free;
+        }
+    }
+    pthread_mutex_unlock(&_m_slabs);
+
+    while (extra != NULL) {
+        char *slab = reinterpret_cast<char *>(extra);
+        extra = extra->next;
+        delete[] slab;
+        Stats::addLocal(STAT_POOLED_BUFFER_BYTES, -static_cast<long>(sizeOf(kind)));
+    }
+}
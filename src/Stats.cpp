@@ -0,0 +1,210 @@
+#include "Stats.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+volatile long   Stats::_counters[STAT_COUNT] = { 0 };
+long            Stats::_listenOverflows = 0;
+
+Stats::Local   *Stats::_locals = NULL;
+pthread_mutex_t Stats::_m_locals = PTHREAD_MUTEX_INITIALIZER;
+pthread_key_t   Stats::_k_local;
+pthread_once_t  Stats::_once = PTHREAD_ONCE_INIT;
+
+const char *Stats::_names[STAT_COUNT] = {
+    "wakeups",
+    "events",
+    "write_events",
+    "spurious_write_events",
+    "accepted",
+    "accept_errors",
+    "accept_budget_exhausted",
+    "listen_overflows",
+    "cross_thread_wakeups",
+    "queued_jobs",
+    "queue_wait_us",
+    "queue_wait_max_us",
+    "stolen_jobs",
+    "cancelled_jobs",
+    "rejected_jobs",
+    "workers",
+    "workers_spawned",
+    "workers_retired",
+    "inline_redirects",
+    "inline_options",
+    "inline_trace",
+    "inline_errors",
+    "inline_auth",
+    "inline_not_modified",
+    "dns_lookups",
+    "dns_cache_hits",
+    "connections",
+    "idle_connections",
+    "idle_connection_bytes",
+    "read_buffer_bytes",
+    "pooled_buffer_bytes",
+    "tunnels",
+    "tunnel_bytes"
+};
+
+// Kernel doesn't count accept queue overflows per socket,
+// so the counter of the whole network namespace is taken
+// and only overflows since server start are reported.
+long
+Stats::readListenOverflows(void) {
+
+    std::ifstream netstat("/proc/net/netstat");
+    if (!netstat.is_open()) {
+        return 0;
+    }
+
+    std::string names;
+    std::string values;
+    while (std::getline(netstat, names) && std::getline(netstat, values)) {
+        if (names.compare(0, 7, "TcpExt:") != 0) {
+            continue ;
+        }
+
+        std::istringstream nss(names);
+        std::istringstream vss(values);
+        std::string name;
+        std::string value;
+        while (nss >> name && vss >> value) {
+            if (name == "ListenOverflows") {
+                return std::strtol(value.c_str(), NULL, 10);
+            }
+        }
+    }
+    return 0;
+}
+
+void
+Stats::init(void) {
+    _listenOverflows = readListenOverflows();
+}
+
+void
+Stats::inc(StatsCounter id) {
+    __sync_fetch_and_add(&_counters[id], 1);
+}
+
+void
+Stats::add(StatsCounter id, long value) {
+    __sync_fetch_and_add(&_counters[id], value);
+}
+
+void
+Stats::set(StatsCounter id, long value) {
+    __sync_lock_test_and_set(&_counters[id], value);
+}
+
+void
+Stats::max(StatsCounter id, long value) {
+    long current = _counters[id];
+    while (value > current) {
+        if (__sync_bool_compare_and_swap(&_counters[id], current, value)) {
+            break ;
+        }
+        current = _counters[id];
+    }
+}
+
+// Only the owner thread writes its counters, so they are
+// updated with plain adds
+void
+Stats::incLocal(StatsCounter id) {
+    addLocal(id, 1);
+}
+
+void
+Stats::addLocal(StatsCounter id, long value) {
+
+    Local *counters = local();
+    if (counters == NULL) {
+        add(id, value);
+        return ;
+    }
+    counters->counters[id] += value;
+}
+
+long
+Stats::get(StatsCounter id) {
+
+    long value = __sync_fetch_and_add(&_counters[id], 0);
+
+    pthread_mutex_lock(&_m_locals);
+    for (Local *it = _locals; it != NULL; it = it->next) {
+        value += it->counters[id];
+    }
+    pthread_mutex_unlock(&_m_locals);
+    return value;
+}
+
+// Counters of the calling thread, made on the first use
+Stats::Local *
+Stats::local(void) {
+
+    pthread_once(&_once, createKey);
+
+    Local *counters = static_cast<Local *>(pthread_getspecific(_k_local));
+    if (counters != NULL) {
+        return counters;
+    }
+
+    counters = new Local();
+    if (pthread_setspecific(_k_local, counters) != 0) {
+        delete counters;
+        return NULL;
+    }
+
+    pthread_mutex_lock(&_m_locals);
+    counters->next = _locals;
+    _locals = counters;
+    pthread_mutex_unlock(&_m_locals);
+    return counters;
+}
+
+void
+Stats::createKey(void) {
+    pthread_key_create(&_k_local, releaseLocal);
+}
+
+// Counts of the exiting thread (a retired worker) go to the shared counters
+void
+Stats::releaseLocal(void *ptr) {
+
+    Local *counters = static_cast<Local *>(ptr);
+
+    pthread_mutex_lock(&_m_locals);
+    for (Local **it = &_locals; *it != NULL; it = &(*it)->next) {
+        if (*it == counters) {
+            *it = counters->next;
+            break ;
+        }
+    }
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        __sync_fetch_and_add(&_counters[i], counters->counters[i]);
+    }
+    pthread_mutex_unlock(&_m_locals);
+
+    delete counters;
+}
+
+void
+Stats::print(void) {
+    set(STAT_LISTEN_OVERFLOWS, readListenOverflows() - _listenOverflows);
+
+    Log.info() << "Stats:";
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        Log << " " << _names[i] << "=" << get(static_cast<StatsCounter>(i));
+    }
+
+    // Heap taken by idle connections, as measured when they
+    // went idle (kernel socket memory aside)
+    const long idle = get(STAT_IDLE_CONNECTIONS);
+    if (idle > 0) {
+        Log << " bytes_per_idle_connection=" << get(STAT_IDLE_CONNECTION_BYTES) / idle;
+    }
+    Log << Log.endl;
+}
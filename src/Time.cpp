@@ -63,4 +63,14 @@ namespace Time {
         return std::time(NULL);
     }
 
+    // Monotonic microseconds, for measuring intervals only
+    uint64_t
+    usec(void) {
+        struct timespec ts;
+        if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+            return 0;
+        }
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
 }
@@ -0,0 +1,153 @@
+#include "TimerWheel.hpp"
+#include "Time.hpp"
+
+Timer::Timer(int kind, void *data)
+    : expires(0)
+    , kind(kind)
+    , data(data)
+    , prev(NULL)
+    , next(NULL) {}
+
+bool Timer::scheduled(void) const {
+    return next != NULL;
+}
+
+// Every slot is a circular list with a sentinel head
+TimerWheel::TimerWheel(void)
+    : _current(Time::now())
+    , _size(0) {
+
+    for (int l = 0; l < levels; ++l) {
+        for (int s = 0; s < slots; ++s) {
+            _wheel[l][s].prev = &_wheel[l][s];
+            _wheel[l][s].next = &_wheel[l][s];
+        }
+    }
+}
+
+TimerWheel::~TimerWheel(void) {}
+
+// Timer already due is fired on the next tick
+void TimerWheel::add(Timer *timer, std::time_t expires) {
+
+    remove(timer);
+
+    timer->expires = expires;
+    place(timer, expires > _current ? expires : _current + 1);
+    ++_size;
+}
+
+void TimerWheel::remove(Timer *timer) {
+
+    if (!timer->scheduled()) {
+        return ;
+    }
+
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = NULL;
+    timer->next = NULL;
+    --_size;
+}
+
+// Level is chosen by distance to the expiration time, slot by the
+// time itself. Timers farther than the whole wheel wait in the last
+// level and are placed again when it comes round.
+void TimerWheel::place(Timer *timer, std::time_t at) {
+
+    std::time_t delta = at - _current;
+
+    int level = 0;
+    while (level < levels - 1 && delta >= (static_cast<std::time_t>(1) << (bits * (level + 1)))) {
+        ++level;
+    }
+
+    const std::time_t range = static_cast<std::time_t>(1) << (bits * levels);
+    if (delta >= range) {
+        at = _current + range - 1;
+    }
+
+    Timer *head = &_wheel[level][(at >> (bits * level)) & (slots - 1)];
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+void TimerWheel::cascade(int level, int slot) {
+
+    Timer *head = &_wheel[level][slot];
+    Timer *timer = head->next;
+
+    head->prev = head;
+    head->next = head;
+
+    while (timer != head) {
+        Timer *next = timer->next;
+        place(timer, timer->expires > _current ? timer->expires : _current);
+        timer = next;
+    }
+}
+
+// Moves the wheel to now and collects expired timers (unscheduled)
+void TimerWheel::advance(std::time_t now, TimersVec &expired) {
+
+    if (_size == 0 && now > _current) {
+        _current = now;
+    }
+
+    while (_current < now) {
+        ++_current;
+
+        // Slots of upper levels come when lower bits of time are zero.
+        // They are moved down from the top one, so timers could go
+        // down more than one level at once.
+        int top = 0;
+        while (top < levels - 1 && (_current & ((static_cast<std::time_t>(1) << (bits * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        for (int l = top; l >= 1; --l) {
+            cascade(l, (_current >> (bits * l)) & (slots - 1));
+        }
+
+        Timer *head = &_wheel[0][_current & (slots - 1)];
+        while (head->next != head) {
+            Timer *timer = head->next;
+            remove(timer);
+            expired.push_back(timer);
+        }
+    }
+}
+
+// Seconds till the nearest expiration or cascade, -1 if there are
+// no timers. Only the next slot of every level is looked for.
+long TimerWheel::nextTimeout(std::time_t now) const {
+
+    if (_size == 0) {
+        return -1;
+    }
+
+    long nearest = -1;
+    for (int l = 0; l < levels; ++l) {
+        const std::time_t base = _current >> (bits * l);
+
+        for (int i = 1; i <= slots; ++i) {
+            const Timer *head = &_wheel[l][(base + i) & (slots - 1)];
+            if (head->next == head) {
+                continue ;
+            }
+
+            std::time_t at = (base + i) << (bits * l);
+            long timeout = (at > now) ? static_cast<long>(at - now) : 0;
+            if (nearest < 0 || timeout < nearest) {
+                nearest = timeout;
+            }
+            break ;
+        }
+    }
+    return nearest;
+}
+
+std::size_t TimerWheel::size(void) const {
+    return _size;
+}
@@ -0,0 +1,218 @@
+#include "Tunnel.hpp"
+#include "Logger.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const std::size_t PIPE_SIZE = 65536;
+
+Tunnel::Tunnel(void) {
+
+    Direction *dirs[2] = { &_up, &_down };
+    for (int i = 0; i < 2; ++i) {
+        dirs[i]->from = -1;
+        dirs[i]->to = -1;
+        dirs[i]->pipe[0] = -1;
+        dirs[i]->pipe[1] = -1;
+        dirs[i]->inPipe = 0;
+        dirs[i]->eof = false;
+        dirs[i]->closed = false;
+    }
+}
+
+Tunnel::~Tunnel(void) {
+
+    Direction *dirs[2] = { &_up, &_down };
+    for (int i = 0; i < 2; ++i) {
+        if (dirs[i]->pipe[0] != -1) {
+            close(dirs[i]->pipe[0]);
+            close(dirs[i]->pipe[1]);
+        }
+    }
+}
+
+// Early bytes are the ones client sent right after CONNECT
+int
+Tunnel::init(int clientFd, int gatewayFd, const std::string &early) {
+
+    _up.from = clientFd;
+    _up.to = gatewayFd;
+    _up.data = early;
+    _down.from = gatewayFd;
+    _down.to = clientFd;
+
+#ifdef __linux__
+    Direction *dirs[2] = { &_up, &_down };
+    for (int i = 0; i < 2; ++i) {
+        if (pipe2(dirs[i]->pipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+            Log.syserr() << "Tunnel::pipe failed" << Log.endl;
+            return -1;
+        }
+    }
+#endif
+    return 0;
+}
+
+// Returns number of bytes moved in both directions, or -1
+long
+Tunnel::relay(void) {
+
+    long up = pump(_up);
+    if (up < 0) {
+        return -1;
+    }
+
+    long down = pump(_down);
+    if (down < 0) {
+        return -1;
+    }
+    return up + down;
+}
+
+// Peer of fd is gone: nothing could be sent to it anymore, and
+// what is left unread is taken right away, so fd could be closed
+void
+Tunnel::hangup(int fd) {
+
+    Direction *dirs[2] = { &_up, &_down };
+    for (int i = 0; i < 2; ++i) {
+        if (dirs[i]->to == fd) {
+            dirs[i]->closed = true;
+            dirs[i]->data.clear();
+        }
+        if (dirs[i]->from == fd && !dirs[i]->eof) {
+            drain(*dirs[i]);
+            dirs[i]->eof = true;
+        }
+    }
+}
+
+bool
+Tunnel::wantsInput(int fd) const {
+
+    const Direction &dir = (fd == _up.from ? _up : _down);
+    return dir.from == fd && !dir.eof && !dir.closed && dir.inPipe == 0 && dir.data.empty();
+}
+
+bool
+Tunnel::wantsOutput(int fd) const {
+
+    const Direction &dir = (fd == _up.to ? _up : _down);
+    return dir.to == fd && !dir.closed && (dir.inPipe != 0 || !dir.data.empty());
+}
+
+bool
+Tunnel::finished(void) const {
+    return _up.closed && _down.closed;
+}
+
+// Moves data until the source or the destination would block.
+// When the source is drained, destination is shut down for writing.
+long
+Tunnel::pump(Direction &dir) {
+
+    long moved = 0;
+
+    while (!dir.closed) {
+
+        if (dir.inPipe != 0 || !dir.data.empty()) {
+            long bytes = flush(dir);
+            if (bytes < 0) {
+                return (errno == EAGAIN || errno == EWOULDBLOCK) ? moved : -1;
+            }
+            if (bytes == 0) {
+                break ;
+            }
+            moved += bytes;
+            continue ;
+        }
+
+        if (dir.eof) {
+            shutdown(dir.to, SHUT_WR);
+            dir.closed = true;
+            break ;
+        }
+
+        long bytes = fill(dir);
+        if (bytes < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? moved : -1;
+        }
+        if (bytes == 0) {
+            dir.eof = true;
+        }
+    }
+    return moved;
+}
+
+// Data goes after the one in the pipe
+void
+Tunnel::drain(Direction &dir) {
+
+    char buf[PIPE_SIZE];
+
+    long bytes;
+    while ((bytes = read(dir.from, buf, PIPE_SIZE)) > 0) {
+        dir.data.append(buf, bytes);
+    }
+}
+
+#ifdef __linux__
+
+long
+Tunnel::fill(Direction &dir) {
+
+    long bytes = splice(dir.from, NULL, dir.pipe[1], NULL, PIPE_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (bytes > 0) {
+        dir.inPipe += bytes;
+    }
+    return bytes;
+}
+
+// Pipe goes first: early bytes are written before anything is
+// put into it, and bytes drained at hangup come after it
+long
+Tunnel::flush(Direction &dir) {
+
+    if (dir.inPipe != 0) {
+        long bytes = splice(dir.pipe[0], NULL, dir.to, NULL, dir.inPipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (bytes > 0) {
+            dir.inPipe -= bytes;
+        }
+        return bytes;
+    }
+
+    long bytes = write(dir.to, dir.data.c_str(), dir.data.length());
+    if (bytes > 0) {
+        dir.data.erase(0, bytes);
+    }
+    return bytes;
+}
+
+#else
+
+// Without splice() data goes through userspace
+long
+Tunnel::fill(Direction &dir) {
+
+    char buf[PIPE_SIZE];
+
+    long bytes = read(dir.from, buf, PIPE_SIZE);
+    if (bytes > 0) {
+        dir.data.append(buf, bytes);
+    }
+    return bytes;
+}
+
+long
+Tunnel::flush(Direction &dir) {
+
+    long bytes = write(dir.to, dir.data.c_str(), dir.data.length());
+    if (bytes > 0) {
+        dir.data.erase(0, bytes);
+    }
+    return bytes;
+}
+
+#endif
@@ -0,0 +1,895 @@
+#include "UringEngine.hpp"
+
+#ifdef WS_URING
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const unsigned ringEntries = 4096;
+
+// Provided buffers for receiving: a completion holds its
+// buffer only till the next wait, so a few are enough
+static const unsigned    bufEntries = 256;
+static const std::size_t bufSize = 16384;
+static const uint16_t    bufGroup = 0;
+
+// user_data keeps kind of the request, descriptor and its sequence,
+// so completions of removed (or reused) descriptors are dropped.
+// Send is tagged by its operation: user space addresses leave
+// the upper bits clear.
+enum Kind {
+    K_POLL = 0,
+    K_RECV = 1,
+    K_ACCEPT = 2,
+    K_SEND = 3
+};
+
+static const uint64_t ignoredTag = ~static_cast<uint64_t>(0);
+static const int      kindShift = 62;
+static const uint32_t seqMask = 0x3fffffff;
+
+static uint64_t
+toTag(Kind kind, uint32_t seq, int fd) {
+    return (static_cast<uint64_t>(kind) << kindShift)
+        | (static_cast<uint64_t>(seq & seqMask) << 32)
+        | static_cast<uint32_t>(fd);
+}
+
+static uint64_t
+toTag(UringEngine::SendOp *op) {
+    return (static_cast<uint64_t>(K_SEND) << kindShift) | reinterpret_cast<uintptr_t>(op);
+}
+
+static Kind
+kindOf(uint64_t tag) {
+    return static_cast<Kind>(tag >> kindShift);
+}
+
+static uint32_t
+seqOf(uint64_t tag) {
+    return static_cast<uint32_t>(tag >> 32) & seqMask;
+}
+
+static int
+fdOf(uint64_t tag) {
+    return static_cast<int>(tag & 0xffffffff);
+}
+
+static UringEngine::SendOp *
+opOf(uint64_t tag) {
+    const uint64_t mask = (static_cast<uint64_t>(1) << kindShift) - 1;
+    return reinterpret_cast<UringEngine::SendOp *>(static_cast<uintptr_t>(tag & mask));
+}
+
+static uint32_t
+toPoll(uint32_t events) {
+    uint32_t res = 0;
+    if (events & EVENT_IN) {
+        res |= POLLIN | POLLRDHUP;
+    }
+    if (events & EVENT_OUT) {
+        res |= POLLOUT;
+    }
+    return res;
+}
+
+static uint32_t
+fromPoll(int revents) {
+    uint32_t res = EVENT_NONE;
+    if (revents < 0) {
+        return EVENT_ERR;
+    }
+    if (revents & (POLLIN | POLLRDHUP)) {
+        res |= EVENT_IN;
+    }
+    if (revents & POLLOUT) {
+        res |= EVENT_OUT;
+    }
+    if (revents & POLLHUP) {
+        res |= EVENT_HUP;
+    }
+    if (revents & (POLLERR | POLLNVAL)) {
+        res |= EVENT_ERR;
+    }
+    return res;
+}
+
+UringEngine::UringEngine(void)
+    : _ringfd(-1)
+    , _sqMap(MAP_FAILED)
+    , _sqMapSize(0)
+    , _cqMap(MAP_FAILED)
+    , _cqMapSize(0)
+    , _sqesMap(MAP_FAILED)
+    , _sqesMapSize(0)
+    , _sqHead(NULL)
+    , _sqTail(NULL)
+    , _sqMask(0)
+    , _sqEntries(0)
+    , _sqArray(NULL)
+    , _sqes(NULL)
+    , _cqHead(NULL)
+    , _cqTail(NULL)
+    , _cqMask(0)
+    , _cqes(NULL)
+    , _toSubmit(0)
+    , _completes(false)
+    , _bufRingMap(MAP_FAILED)
+    , _bufRingMapSize(0)
+    , _bufsMap(MAP_FAILED)
+    , _bufsMapSize(0)
+    , _bufRing(NULL)
+    , _bufTail(0) {}
+
+UringEngine::~UringEngine(void) {
+
+    if (_ringfd != -1) {
+        close(_ringfd);
+    }
+    if (_sqesMap != MAP_FAILED) {
+        munmap(_sqesMap, _sqesMapSize);
+    }
+    if (_cqMap != MAP_FAILED && _cqMap != _sqMap) {
+        munmap(_cqMap, _cqMapSize);
+    }
+    if (_sqMap != MAP_FAILED) {
+        munmap(_sqMap, _sqMapSize);
+    }
+    if (_bufsMap != MAP_FAILED) {
+        munmap(_bufsMap, _bufsMapSize);
+    }
+    if (_bufRingMap != MAP_FAILED) {
+        munmap(_bufRingMap, _bufRingMapSize);
+    }
+}
+
+const char *
+UringEngine::name(void) const {
+    return "io_uring";
+}
+
+bool
+UringEngine::completes(void) const {
+    return _completes;
+}
+
+// Rings are set up and mapped without liburing
+int
+UringEngine::init(void) {
+
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP | IORING_SETUP_CQSIZE;
+    params.cq_entries = ringEntries * 4;
+
+    _ringfd = syscall(__NR_io_uring_setup, ringEntries, &params);
+    if (_ringfd < 0) {
+        Log.syserr() << "UringEngine::io_uring_setup failed" << Log.endl;
+        return -1;
+    }
+
+    _sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        _sqMapSize = std::max(_sqMapSize, _cqMapSize);
+        _cqMapSize = _sqMapSize;
+    }
+
+    _sqMap = mmap(NULL, _sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_SQ_RING);
+    if (_sqMap == MAP_FAILED) {
+        Log.syserr() << "UringEngine::mmap of submission ring failed" << Log.endl;
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        _cqMap = _sqMap;
+    } else {
+        _cqMap = mmap(NULL, _cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_CQ_RING);
+        if (_cqMap == MAP_FAILED) {
+            Log.syserr() << "UringEngine::mmap of completion ring failed" << Log.endl;
+            return -1;
+        }
+    }
+
+    _sqesMapSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    _sqesMap = mmap(NULL, _sqesMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_SQES);
+    if (_sqesMap == MAP_FAILED) {
+        Log.syserr() << "UringEngine::mmap of submission entries failed" << Log.endl;
+        return -1;
+    }
+
+    char *sq = static_cast<char *>(_sqMap);
+    _sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    _sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    _sqEntries = params.sq_entries;
+    _sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    _sqes = static_cast<struct io_uring_sqe *>(_sqesMap);
+
+    char *cq = static_cast<char *>(_cqMap);
+    _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    if (!(params.features & IORING_FEAT_NODROP)) {
+        Log.info() << "UringEngine:: kernel could drop completions on overflow" << Log.endl;
+    }
+
+    _completes = (initBuffers() == 0);
+    if (!_completes) {
+        Log.info() << "UringEngine:: multishot receiving is not supported, descriptors are polled" << Log.endl;
+    }
+    return 0;
+}
+
+// Ring of provided buffers is registered for receiving.
+// Multishot recv needs 6.0, it isn't told apart otherwise.
+int
+UringEngine::initBuffers(void) {
+
+    struct utsname uts;
+    if (uname(&uts) < 0 || std::atoi(uts.release) < 6) {
+        return -1;
+    }
+
+    _bufRingMapSize = bufEntries * sizeof(struct io_uring_buf);
+    _bufRingMap = mmap(NULL, _bufRingMapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (_bufRingMap == MAP_FAILED) {
+        Log.syserr() << "UringEngine::mmap of buffers ring failed" << Log.endl;
+        return -1;
+    }
+
+    _bufsMapSize = bufEntries * bufSize;
+    _bufsMap = mmap(NULL, _bufsMapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (_bufsMap == MAP_FAILED) {
+        Log.syserr() << "UringEngine::mmap of buffers failed" << Log.endl;
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(_bufRingMap);
+    reg.ring_entries = bufEntries;
+    reg.bgid = bufGroup;
+
+    if (syscall(__NR_io_uring_register, _ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        Log.debug() << "UringEngine::io_uring_register of buffers failed: " << strerror(errno) << Log.endl;
+        return -1;
+    }
+
+    _bufRing = static_cast<struct io_uring_buf *>(_bufRingMap);
+    for (unsigned bid = 0; bid < bufEntries; ++bid) {
+        _consumed.push_back(bid);
+    }
+    recycle();
+    return 0;
+}
+
+// Ring is an array of buffers, its tail overlaps
+// the reserved field of the first one
+void
+UringEngine::provide(uint16_t bid) {
+
+    struct io_uring_buf *buf = &_bufRing[_bufTail & (bufEntries - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(static_cast<char *>(_bufsMap) + bid * bufSize);
+    buf->len = bufSize;
+    buf->bid = bid;
+    ++_bufTail;
+}
+
+// Buffers of the previous completions are given back
+void
+UringEngine::recycle(void) {
+
+    if (_consumed.empty()) {
+        return ;
+    }
+    for (std::size_t i = 0; i < _consumed.size(); ++i) {
+        provide(_consumed[i]);
+    }
+    _consumed.clear();
+
+    __sync_synchronize();
+    *reinterpret_cast<volatile uint16_t *>(&_bufRing[0].resv) = _bufTail;
+}
+
+UringEngine::Slot *
+UringEngine::slot(int fd) {
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (static_cast<std::size_t>(fd) >= _slots.size()) {
+        Slot empty;
+        empty.events = 0;
+        empty.mask = 0;
+        empty.gen = 0;
+        empty.reg = 0;
+        empty.registered = false;
+        empty.armed = false;
+        empty.dirty = false;
+        empty.listener = false;
+        empty.receiving = false;
+        empty.cancelling = false;
+        empty.ended = false;
+        empty.sendOp = NULL;
+        _slots.resize(fd + 1, empty);
+    }
+    return &_slots[fd];
+}
+
+int
+UringEngine::enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, _ringfd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+int
+UringEngine::submit(void) {
+
+    int res = enter(_toSubmit, 0, 0);
+    if (res < 0) {
+        Log.syserr() << "UringEngine::io_uring_enter failed" << Log.endl;
+        return -1;
+    }
+    _toSubmit -= res;
+    return 0;
+}
+
+// Entries are submitted in batch by wait(), or right
+// here if the submission ring has been filled up
+struct io_uring_sqe *
+UringEngine::getSqe(void) {
+
+    unsigned tail = *_sqTail;
+    __sync_synchronize();
+    if (tail - *_sqHead >= _sqEntries) {
+        if (submit() < 0) {
+            return NULL;
+        }
+        __sync_synchronize();
+        if (tail - *_sqHead >= _sqEntries) {
+            return NULL;
+        }
+    }
+
+    const unsigned index = tail & _sqMask;
+    struct io_uring_sqe *sqe = &_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    _sqArray[index] = index;
+
+    __sync_synchronize();
+    *_sqTail = tail + 1;
+    ++_toSubmit;
+
+    return sqe;
+}
+
+// Requests of the descriptor are brought in line
+// with its state by the next wait
+void
+UringEngine::touch(int fd) {
+
+    Slot *s = slot(fd);
+    if (!s->dirty) {
+        s->dirty = true;
+        _dirty.push_back(fd);
+    }
+}
+
+// Stream is received while it's read, and polled only for
+// writing when no send is in flight (or for hangup if it's not
+// read). Poll for reading waits till a cancelled recv is over.
+void
+UringEngine::update(int fd) {
+
+    Slot *s = slot(fd);
+    s->dirty = false;
+    if (!s->registered) {
+        return ;
+    }
+
+    if (s->listener) {
+        if (!s->receiving) {
+            accept(fd);
+        }
+        return ;
+    }
+
+    const bool stream = (s->events & EVENT_STREAM);
+    const bool in = stream && (s->events & EVENT_IN) && !s->ended;
+
+    if (in && !s->receiving) {
+        receive(fd);
+    } else if (!in && s->receiving && !s->cancelling) {
+        cancel(toTag(K_RECV, s->reg, fd));
+        s->cancelling = true;
+    }
+
+    uint32_t mask = 0;
+    bool     needed = true;
+    if (!stream) {
+        mask = toPoll(s->receiving ? s->events & ~EVENT_IN : s->events);
+    } else {
+        if ((s->events & EVENT_OUT) && s->sendOp == NULL) {
+            mask = POLLOUT;
+        }
+        needed = (mask != 0 || !in);
+    }
+
+    if (s->armed && (!needed || s->mask != mask)) {
+        disarm(fd);
+    }
+    if (needed && !s->armed) {
+        arm(fd, mask);
+    }
+}
+
+void
+UringEngine::arm(int fd, uint32_t mask) {
+
+    Slot *s = slot(fd);
+
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) {
+        Log.error() << "UringEngine::arm [" << fd << "] submission ring is full" << Log.endl;
+        return ;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = mask;
+    sqe->user_data = toTag(K_POLL, s->gen, fd);
+    s->mask = mask;
+    s->armed = true;
+}
+
+// Poll is cancelled by its tag, generation is changed
+// so its completion (if already posted) is dropped
+void
+UringEngine::disarm(int fd) {
+
+    Slot *s = slot(fd);
+    if (s->armed) {
+        struct io_uring_sqe *sqe = getSqe();
+        if (sqe != NULL) {
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->fd = -1;
+            sqe->addr = toTag(K_POLL, s->gen, fd);
+            sqe->user_data = ignoredTag;
+        }
+        s->armed = false;
+    }
+    s->gen++;
+}
+
+// Accepted connections come non-blocking and close-on-exec,
+// the address of the peer is asked by the owner
+void
+UringEngine::accept(int fd) {
+
+    Slot *s = slot(fd);
+
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) {
+        Log.error() << "UringEngine::accept [" << fd << "] submission ring is full" << Log.endl;
+        touch(fd);
+        return ;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = toTag(K_ACCEPT, s->reg, fd);
+    s->receiving = true;
+}
+
+void
+UringEngine::receive(int fd) {
+
+    Slot *s = slot(fd);
+
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) {
+        Log.error() << "UringEngine::receive [" << fd << "] submission ring is full" << Log.endl;
+        touch(fd);
+        return ;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bufGroup;
+    sqe->user_data = toTag(K_RECV, s->reg, fd);
+    s->receiving = true;
+}
+
+// Send waits for all of its data, so it's short only if
+// it's interrupted; the rest is sent after a poll then
+bool
+UringEngine::startSend(SendOp *op) {
+
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) {
+        Log.error() << "UringEngine::send [" << op->fd << "] submission ring is full" << Log.endl;
+        return false;
+    }
+
+    std::memset(&op->msg, 0, sizeof(op->msg));
+    op->msg.msg_iov = &op->iov[op->first];
+    op->msg.msg_iovlen = op->iov.size() - op->first;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = op->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&op->msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    if (op->sent > 0) {
+        sqe->ioprio = IORING_RECVSEND_POLL_FIRST;
+    }
+    sqe->user_data = toTag(op);
+    return true;
+}
+
+void
+UringEngine::cancel(uint64_t tag) {
+
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = tag;
+        sqe->user_data = ignoredTag;
+    }
+}
+
+int
+UringEngine::add(int fd, uint32_t events) {
+
+    Slot *s = slot(fd);
+    if (s == NULL || s->registered) {
+        Log.error() << "UringEngine::add [" << fd << "] failed" << Log.endl;
+        return -1;
+    }
+
+    s->registered = true;
+    s->events = _completes ? events : events & ~EVENT_STREAM;
+    s->gen++;
+    s->reg++;
+    touch(fd);
+    return 0;
+}
+
+int
+UringEngine::listen(int fd) {
+
+    if (!_completes) {
+        return add(fd, EVENT_IN);
+    }
+    if (add(fd, EVENT_IN) < 0) {
+        return -1;
+    }
+    slot(fd)->listener = true;
+    return 0;
+}
+
+int
+UringEngine::mod(int fd, uint32_t events) {
+
+    Slot *s = slot(fd);
+    if (s == NULL || !s->registered) {
+        Log.debug() << "UringEngine::mod [" << fd << "] failed" << Log.endl;
+        return -1;
+    }
+
+    if (!_completes) {
+        events &= ~EVENT_STREAM;
+    }
+    if (s->events == events) {
+        return 0;
+    }
+    s->events = events;
+    touch(fd);
+    return 0;
+}
+
+// Requests keep a reference to the file, so they're cancelled
+// even though descriptor is closed before submission. Send in
+// flight is left to free itself on its completion; it's cancelled
+// right away, as memory it sends could be freed with its owner.
+int
+UringEngine::del(int fd) {
+
+    Slot *s = slot(fd);
+    if (s == NULL || !s->registered) {
+        Log.debug() << "UringEngine::del [" << fd << "] failed" << Log.endl;
+        return -1;
+    }
+
+    disarm(fd);
+    if (s->receiving) {
+        cancel(toTag(s->listener ? K_ACCEPT : K_RECV, s->reg, fd));
+    }
+    if (s->sendOp != NULL) {
+        cancel(toTag(s->sendOp));
+        submit();
+    }
+
+    s->reg++;
+    s->registered = false;
+    s->listener = false;
+    s->receiving = false;
+    s->cancelling = false;
+    s->ended = false;
+    s->sendOp = NULL;
+    return 0;
+}
+
+// One send is in flight at a time, it takes the whole iovecs.
+// Returns number of bytes taken, or -1.
+long
+UringEngine::send(int fd, const struct iovec *iov, int count, StringsVec &kept) {
+
+    Slot *s = slot(fd);
+    if (s == NULL || !s->registered) {
+        errno = EBADF;
+        return -1;
+    }
+    if (s->sendOp != NULL) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    SendOp *op = new SendOp();
+    op->fd = fd;
+    op->iov.assign(iov, iov + count);
+    op->first = 0;
+    op->size = 0;
+    op->sent = 0;
+    for (int i = 0; i < count; ++i) {
+        op->size += iov[i].iov_len;
+    }
+
+    if (!startSend(op)) {
+        delete op;
+        errno = EAGAIN;
+        return -1;
+    }
+    op->kept.swap(kept);
+
+    // Writability isn't polled while sending
+    s->sendOp = op;
+    touch(fd);
+    return op->size;
+}
+
+// Bytes which are taken but not sent yet
+std::size_t
+UringEngine::sending(int fd) const {
+
+    if (fd < 0 || static_cast<std::size_t>(fd) >= _slots.size()) {
+        return 0;
+    }
+    const Slot &s = _slots[fd];
+    if (s.sendOp == NULL) {
+        return 0;
+    }
+    return s.sendOp->size - s.sendOp->sent;
+}
+
+void
+UringEngine::report(int fd, uint32_t events, int res, const char *data) {
+
+    if (_ready.size() <= _nbReady) {
+        _ready.resize(_nbReady + 1);
+    }
+    _ready[_nbReady].fd = fd;
+    _ready[_nbReady].events = events;
+    _ready[_nbReady].res = res;
+    _ready[_nbReady].data = data;
+    _nbReady++;
+}
+
+void
+UringEngine::completePoll(int fd, const struct io_uring_cqe *cqe) {
+
+    Slot *s = slot(fd);
+    if (!s->registered || (s->gen & seqMask) != seqOf(cqe->user_data)) {
+        return ;
+    }
+    s->armed = false;
+    touch(fd);
+
+    report(fd, fromPoll(cqe->res), 0, NULL);
+}
+
+// Errors of accept are reported too, the listener is served on
+void
+UringEngine::completeAccept(int fd, const struct io_uring_cqe *cqe) {
+
+    Slot *s = slot(fd);
+    if (!s->registered || (s->reg & seqMask) != seqOf(cqe->user_data)) {
+        if (cqe->res >= 0) {
+            close(cqe->res);
+        }
+        return ;
+    }
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        s->receiving = false;
+        touch(fd);
+    }
+    if (cqe->res != -ECANCELED) {
+        report(fd, EVENT_IN | EVENT_COMPLETE, cqe->res, NULL);
+    }
+}
+
+// Received data stays in its buffer till the next wait. Recv is
+// stopped by the kernel when buffers run out, it's restarted then.
+// Data of a cancelled recv is still reported, it's taken from the socket.
+void
+UringEngine::completeRecv(int fd, const struct io_uring_cqe *cqe) {
+
+    const char *data = NULL;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        const uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        _consumed.push_back(bid);
+        data = static_cast<const char *>(_bufsMap) + bid * bufSize;
+    }
+
+    Slot *s = slot(fd);
+    if (!s->registered || (s->reg & seqMask) != seqOf(cqe->user_data)) {
+        return ;
+    }
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        s->receiving = false;
+        s->cancelling = false;
+        touch(fd);
+    }
+
+    if (cqe->res > 0) {
+        report(fd, EVENT_IN | EVENT_COMPLETE, cqe->res, data);
+    } else if (cqe->res == 0) {
+        s->ended = true;
+        report(fd, EVENT_IN | EVENT_COMPLETE, 0, NULL);
+    } else if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED && cqe->res != -EINTR) {
+        s->ended = true;
+        report(fd, EVENT_ERR | EVENT_COMPLETE, cqe->res, NULL);
+    }
+}
+
+// Send is reported once all of its data has left, so the
+// owner could consume its output and give the rest of it
+void
+UringEngine::completeSend(SendOp *op, const struct io_uring_cqe *cqe) {
+
+    const int fd = op->fd;
+    Slot *s = slot(fd);
+    if (s->sendOp != op) {
+        delete op;
+        return ;
+    }
+
+    if (cqe->res < 0 && cqe->res != -EAGAIN && cqe->res != -EINTR) {
+        s->sendOp = NULL;
+        delete op;
+        report(fd, EVENT_ERR, cqe->res, NULL);
+        return ;
+    }
+
+    for (std::size_t left = cqe->res > 0 ? cqe->res : 0; left > 0; ) {
+        struct iovec &v = op->iov[op->first];
+        if (left < v.iov_len) {
+            v.iov_base = static_cast<char *>(v.iov_base) + left;
+            v.iov_len -= left;
+            break ;
+        }
+        left -= v.iov_len;
+        op->first++;
+    }
+    if (cqe->res > 0) {
+        op->sent += cqe->res;
+    }
+
+    if (op->sent < op->size) {
+        if (!startSend(op)) {
+            s->sendOp = NULL;
+            delete op;
+            report(fd, EVENT_ERR, -EBUSY, NULL);
+        }
+        return ;
+    }
+
+    const long size = op->size;
+    s->sendOp = NULL;
+    delete op;
+    touch(fd);
+
+    report(fd, EVENT_OUT | EVENT_COMPLETE, size, NULL);
+}
+
+int
+UringEngine::wait(int timeout) {
+
+    _nbReady = 0;
+
+    recycle();
+
+    for (std::size_t i = 0; i < _dirty.size(); ++i) {
+        update(_dirty[i]);
+    }
+    _dirty.clear();
+
+    unsigned minComplete = 0;
+    if (timeout != 0) {
+        minComplete = 1;
+    }
+
+    // Timeout completes by itself or with the first other completion
+    if (timeout > 0) {
+        struct io_uring_sqe *sqe = getSqe();
+        if (sqe != NULL) {
+            _ts.tv_sec = timeout / 1000;
+            _ts.tv_nsec = static_cast<long long>(timeout % 1000) * 1000000;
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&_ts);
+            sqe->len = 1;
+            sqe->off = 1;
+            sqe->user_data = ignoredTag;
+        }
+    }
+
+    int res = enter(_toSubmit, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0);
+    if (res < 0) {
+        return -1;
+    }
+    _toSubmit -= res;
+
+    unsigned head = *_cqHead;
+    __sync_synchronize();
+    const unsigned tail = *_cqTail;
+
+    if (_ready.size() < tail - head) {
+        _ready.resize(tail - head);
+    }
+
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe *cqe = &_cqes[head & _cqMask];
+        const uint64_t tag = cqe->user_data;
+        if (tag == ignoredTag) {
+            continue ;
+        }
+
+        switch (kindOf(tag)) {
+        case K_POLL:
+            completePoll(fdOf(tag), cqe);
+            break ;
+        case K_ACCEPT:
+            completeAccept(fdOf(tag), cqe);
+            break ;
+        case K_RECV:
+            completeRecv(fdOf(tag), cqe);
+            break ;
+        case K_SEND:
+            completeSend(opOf(tag), cqe);
+            break ;
+        }
+    }
+
+    __sync_synchronize();
+    *_cqHead = head;
+
+    return _nbReady;
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "Utils.hpp"
+#include "Globals.hpp"
 
 #include <dirent.h>
 #include <sys/stat.h>
@@ -559,6 +560,13 @@ isDirectory(const std::string &dirname) {
     return S_ISDIR(state.st_mode);
 }
 
+// Unfinished upload, which isn't served or listed
+bool
+isUploadFile(const std::string &filename) {
+    const std::size_t pos = filename.rfind('/');
+    return filename.compare(pos == std::string::npos ? 0 : pos + 1, sizeof(UPLOAD_FILE_PREFIX) - 1, UPLOAD_FILE_PREFIX) == 0;
+}
+
 bool
 checkRegFilePerms(const std::string &filename, int perm) {
     struct stat state;
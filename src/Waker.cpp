@@ -0,0 +1,80 @@
+#include "Waker.hpp"
+
+Waker::Waker(void)
+    : _rdFd(-1)
+    , _wrFd(-1)
+    , _pending(0) {}
+
+Waker::~Waker(void) {
+
+    if (_wrFd >= 0 && _wrFd != _rdFd) {
+        close(_wrFd);
+    }
+    if (_rdFd >= 0) {
+        close(_rdFd);
+    }
+}
+
+#ifdef WS_EVENTFD
+
+int Waker::init(void) {
+
+    _rdFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_rdFd < 0) {
+        Log.syserr() << "Waker::eventfd failed" << Log.endl;
+        return -1;
+    }
+    _wrFd = _rdFd;
+    return 0;
+}
+
+#else
+
+int Waker::init(void) {
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        Log.syserr() << "Waker::pipe failed" << Log.endl;
+        return -1;
+    }
+    _rdFd = fds[0];
+    _wrFd = fds[1];
+
+    for (int i = 0; i < 2; ++i) {
+        if (fcntl(fds[i], F_SETFL, O_NONBLOCK) < 0 || fcntl(fds[i], F_SETFD, FD_CLOEXEC) < 0) {
+            Log.syserr() << "Waker::fcntl failed [" << fds[i] << "]" << Log.endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#endif
+
+int Waker::fd(void) const {
+    return _rdFd;
+}
+
+// Could be called from any thread. Full pipe (or eventfd counter)
+// means the loop is going to wake up anyway, so EAGAIN is ignored.
+void Waker::notify(void) {
+
+    if (__sync_lock_test_and_set(&_pending, 1) != 0) {
+        return ;
+    }
+
+    Stats::incLocal(STAT_CROSS_THREAD_WAKEUPS);
+
+    uint64_t one = 1;
+    while (write(_wrFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+}
+
+// Event loop thread only. Pending flag is cleared before reading,
+// so a notification sent meanwhile is never lost.
+void Waker::drain(void) {
+
+    __sync_lock_release(&_pending);
+
+    uint64_t buf[16];
+    while (read(_rdFd, buf, sizeof(buf)) > 0) {}
+}
@@ -1,12 +1,32 @@
 #include "Worker.hpp"
 #include "Server.hpp"
 
-std::size_t Worker::count = 0;
+Worker::Worker(void)
+    : _id(0)
+    , _pool(NULL)
+    , _sleeping(0)
+    , _woken(false)
+    , _retired(false)
+    , _started(false) {
 
-Worker::Worker(void) : _id(count++) {}
-Worker::~Worker(void) {}
+    pthread_mutex_init(&_m_jobs, NULL);
+    pthread_cond_init(&_c_jobs, NULL);
+}
+
+Worker::~Worker(void) {
+    pthread_cond_destroy(&_c_jobs);
+    pthread_mutex_destroy(&_m_jobs);
+}
 
-Worker::Worker(const Worker &other) {
+Worker::Worker(const Worker &other)
+    : _pool(NULL)
+    , _sleeping(0)
+    , _woken(false)
+    , _retired(false)
+    , _started(false) {
+
+    pthread_mutex_init(&_m_jobs, NULL);
+    pthread_cond_init(&_c_jobs, NULL);
     *this = other;
 }
 
@@ -15,19 +35,34 @@ Worker::operator=(const Worker &other) {
     if (this != &other) {
         _id = other._id;
         _thread = other._thread;
+        _pool = other._pool;
     }
     return *this;
 }
 
+void Worker::init(WorkerPool *pool, int id) {
+    _pool = pool;
+    _id = id;
+}
+
 int Worker::id(void) const {
     return _id;
 }
 
+WorkerPool *Worker::pool(void) const {
+    return _pool;
+}
+
+bool Worker::started(void) const {
+    return _started;
+}
+
 int Worker::create(void) {
     if (pthread_create(&_thread, NULL, _cycle, this)) {
         Log.syserr() << "Server::pthread_create failed for worker " << _id << Log.endl;
         return 0;
     }
+    _started = true;
     return 1;
 }
 
@@ -44,30 +79,178 @@ int Worker::join(void) {
         Log.syserr() << "Server::pthread_join failed for worker " << _id << Log.endl;
         return 0;
     }
+    _started = false;
     return 1;
 }
 
+// Returns the queue length with the job, or 0 if it's refused
+std::size_t Worker::push(const Job &job) {
+
+    std::size_t depth = 0;
+
+    pthread_mutex_lock(&_m_jobs);
+
+    if (!_retired) {
+        _jobs.push_back(job);
+        depth = _jobs.size();
+        pthread_cond_signal(&_c_jobs);
+    }
+
+    pthread_mutex_unlock(&_m_jobs);
+
+    return depth;
+}
+
+// Only a worker with an empty queue could leave the pool
+bool Worker::retire(void) {
+
+    pthread_mutex_lock(&_m_jobs);
+
+    _retired = _jobs.empty();
+    const bool retired = _retired;
+
+    pthread_mutex_unlock(&_m_jobs);
+
+    return retired;
+}
+
+void Worker::revive(void) {
+
+    pthread_mutex_lock(&_m_jobs);
+    _retired = false;
+    pthread_mutex_unlock(&_m_jobs);
+}
+
+bool Worker::pop(Job &job) {
+    return take(job, false);
+}
+
+bool Worker::steal(Job &job) {
+    return take(job, true);
+}
+
+// Jobs of removed clients are dropped by their cancelled token,
+// the client itself (and its response) is never touched. Taken
+// job holds a claim, so its client isn't removed till it's done.
+bool Worker::take(Job &job, bool back) {
+
+    bool taken = false;
+
+    pthread_mutex_lock(&_m_jobs);
+
+    while (!taken && !_jobs.empty()) {
+        if (back) {
+            job = _jobs.back();
+            _jobs.pop_back();
+        } else {
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+
+        _pool->dequeued(static_cast<long>(Time::usec() - job.queued));
+
+        if (job.token->claim()) {
+            taken = true;
+            continue ;
+        }
+        Stats::inc(STAT_CANCELLED_JOBS);
+        job.token->release();
+    }
+
+    pthread_mutex_unlock(&_m_jobs);
+
+    return taken;
+}
+
+// Sleeping worker is woken up when a job is queued to a busy one,
+// so it could steal the job
+bool Worker::sleeping(void) const {
+    return _sleeping != 0;
+}
+
+void Worker::sleeping(bool flag) {
+    if (flag) {
+        __sync_lock_test_and_set(&_sleeping, 1);
+    } else {
+        __sync_lock_release(&_sleeping);
+    }
+}
+
+void Worker::wait(std::time_t usec) {
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += usec / 1000000;
+    deadline.tv_nsec += (usec % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&_m_jobs);
+
+    if (!_woken && _jobs.empty()) {
+        pthread_cond_timedwait(&_c_jobs, &_m_jobs, &deadline);
+    }
+    _woken = false;
+
+    pthread_mutex_unlock(&_m_jobs);
+}
+
+void Worker::wake(void) {
+
+    pthread_mutex_lock(&_m_jobs);
+
+    _woken = true;
+    pthread_cond_signal(&_c_jobs);
+
+    pthread_mutex_unlock(&_m_jobs);
+}
+
 void *
 Worker::_cycle(void *ptr) {
     Worker *w = reinterpret_cast<Worker *>(ptr);
 
-    Log.debug() << "Worker " << w->id() << "::cycle started" << Log.endl;
+    Affinity::pinWorker();
+
+    Log.debug() << "Worker " << w->pool()->name() << "/" << w->id() << "::cycle started" << Log.endl;
+
+    const uint64_t idleTimeout = static_cast<uint64_t>(g_server->settings.worker_idle_timeout) * 1000000;
+    uint64_t       idleSince = Time::usec();
+
     while (g_server->working()) {
     
-        HTTP::Response *res = g_server->rmFromRespQ();
-
-        if (res == NULL) {
-            usleep(g_server->settings.worker_timeout);
+        Job job;
+        if (!w->pool()->take(*w, job)) {
+            if (Time::usec() - idleSince >= idleTimeout && w->pool()->retire(*w)) {
+                break ;
+            }
             continue;
         }
 
-        // res->getClient()->processing(true);
+        HTTP::Response *res = job.res;
         const std::string path = res->getRequest()->getUriRef()._path;
+
+        // Client could be removed as soon as the claim is dropped,
+        // so its reactor and descriptors are saved before handling
+        Reactor *reactor = res->getClient()->getReactor();
+        const int clientFd = res->getClient()->getClientIO()->wrFd();
+        const int gatewayFd = res->getClient()->getGatewayIO()->wrFd();
+
         Log.debug() << "Worker " << w->id() << "::cycle: " << path << " started" << Log.endl;
+        const uint64_t started = Time::usec();
         res->handle();
+        idleSince = Time::usec();
+        w->pool()->handled(static_cast<long>(idleSince - started));
         Log.debug() << "Worker " << w->id() << "::cycle: " << path << " finished" << Log.endl;
+
+        job.token->unclaim();
+        job.token->release();
+
+        reactor->armWrite(clientFd);
+        reactor->armWrite(gatewayFd);
     }
 
-    Log.debug() << "Worker " << w->id() << "::cycle stopped" << Log.endl;
+    Log.debug() << "Worker " << w->pool()->name() << "/" << w->id() << "::cycle stopped" << Log.endl;
     return NULL;
 }
@@ -0,0 +1,284 @@
+#include "WorkerPool.hpp"
+#include "Server.hpp"
+
+static void
+updateMax(volatile long *counter, long value) {
+    long current = *counter;
+    while (value > current) {
+        if (__sync_bool_compare_and_swap(counter, current, value)) {
+            break ;
+        }
+        current = *counter;
+    }
+}
+
+WorkerPool::WorkerPool(void)
+    : _workers(NULL)
+    , _minWorkers(0)
+    , _maxWorkers(0)
+    , _maxQueue(0)
+    , _nbWorkers(0)
+    , _nextWorker(0)
+    , _queued(0)
+    , _jobs(0)
+    , _rejected(0)
+    , _waitUs(0)
+    , _waitMaxUs(0)
+    , _handleUs(0)
+    , _handleMaxUs(0) {
+
+    pthread_mutex_init(&_m_workers, NULL);
+}
+
+WorkerPool::~WorkerPool(void) {
+    if (_workers != NULL) {
+        delete[] _workers;
+    }
+    pthread_mutex_destroy(&_m_workers);
+}
+
+const std::string &
+WorkerPool::name(void) const {
+    return _name;
+}
+
+int
+WorkerPool::init(const std::string &name, const Settings::WorkerPoolSettings &sets) {
+
+    _name = name;
+    _minWorkers = sets.workers;
+    _maxWorkers = sets.max_workers;
+    _maxQueue = sets.max_queue;
+
+    _workers = new Worker[_maxWorkers];
+    if (_workers == NULL) {
+        Log.syserr() << "Cannot allocate memory for workers of pool " << _name << Log.endl;
+        return -1;
+    }
+
+    for (std::size_t i = 0; i < _maxWorkers; i++) {
+        _workers[i].init(this, i);
+    }
+    return 0;
+}
+
+void
+WorkerPool::start(void) {
+
+    pthread_mutex_lock(&_m_workers);
+    for (std::size_t i = 0; i < _minWorkers; i++) {
+        if (_workers[i].create()) {
+            _nbWorkers++;
+        }
+    }
+    Stats::add(STAT_WORKERS, _nbWorkers);
+    pthread_mutex_unlock(&_m_workers);
+}
+
+void
+WorkerPool::stop(void) {
+
+    if (_workers == NULL) {
+        return ;
+    }
+
+    for (std::size_t i = 0; i < _maxWorkers; i++) {
+        _workers[i].wake();
+    }
+
+    for (std::size_t i = 0; i < _maxWorkers; i++) {
+        if (_workers[i].started()) {
+            _workers[i].join();
+        }
+    }
+}
+
+// Next slot is started. Thread of a worker retired from
+// this slot has already left its cycle, so join is short.
+void
+WorkerPool::grow(void) {
+
+    if (_nbWorkers >= _maxWorkers || !g_server->working()) {
+        return ;
+    }
+
+    pthread_mutex_lock(&_m_workers);
+
+    if (_nbWorkers < _maxWorkers) {
+        Worker &worker = _workers[_nbWorkers];
+        if (worker.started()) {
+            worker.join();
+        }
+        worker.revive();
+        if (worker.create()) {
+            _nbWorkers++;
+            Stats::inc(STAT_WORKERS_SPAWNED);
+            Stats::inc(STAT_WORKERS);
+            Log.debug() << "WorkerPool " << _name << ":: grown to " << _nbWorkers << Log.endl;
+        }
+    }
+
+    pthread_mutex_unlock(&_m_workers);
+}
+
+// Only the last running worker could leave, so running ones
+// stay at the start of the array. Its queue should be empty.
+bool
+WorkerPool::retire(Worker &worker) {
+
+    bool retired = false;
+
+    pthread_mutex_lock(&_m_workers);
+
+    if (_nbWorkers > _minWorkers
+        && static_cast<std::size_t>(worker.id()) == _nbWorkers - 1
+        && worker.retire()) {
+        _nbWorkers--;
+        retired = true;
+        Stats::inc(STAT_WORKERS_RETIRED);
+        Stats::add(STAT_WORKERS, -1);
+        Log.debug() << "WorkerPool " << _name << ":: shrunk to " << _nbWorkers << Log.endl;
+    }
+
+    pthread_mutex_unlock(&_m_workers);
+
+    return retired;
+}
+
+// Responses of a client go to the same worker with affinity,
+// otherwise workers are taken in turn
+std::size_t
+WorkerPool::pick(HTTP::Client *client) {
+
+    const std::size_t count = _nbWorkers;
+    if (g_server->settings.worker_distribution == "affinity") {
+        return (reinterpret_cast<uintptr_t>(client) >> 4) % count;
+    }
+    return __sync_fetch_and_add(&_nextWorker, 1) % count;
+}
+
+// If the chosen worker is busy, a sleeping one is woken up
+// to steal the job. Flags are read after the job is pushed,
+// and workers look for jobs after they set the flag, so the
+// job can't be left unseen by both. If nobody sleeps and the
+// queue is too long, the pool grows. Worker which is leaving
+// the pool refuses the job, so another one is picked.
+// Returns false if the pool has max_queue jobs already.
+bool
+WorkerPool::push(HTTP::Response *res) {
+
+    const long queued = __sync_add_and_fetch(&_queued, 1);
+    if (_maxQueue != 0 && queued > static_cast<long>(_maxQueue)) {
+        __sync_fetch_and_sub(&_queued, 1);
+        __sync_fetch_and_add(&_rejected, 1);
+        Stats::inc(STAT_REJECTED_JOBS);
+        return false;
+    }
+
+    Worker::Job job;
+    job.res = res;
+    job.token = res->getClient()->getCancelToken();
+    job.token->retain();
+    job.queued = Time::usec();
+
+    std::size_t target = 0;
+    std::size_t depth = 0;
+    while (depth == 0) {
+        target = pick(res->getClient());
+        depth = _workers[target].push(job);
+    }
+
+    __sync_synchronize();
+    if (_workers[target].sleeping()) {
+        return true;
+    }
+
+    const std::size_t count = _nbWorkers;
+    for (std::size_t i = 1; i < count; i++) {
+        Worker &worker = _workers[(target + i) % count];
+        if (worker.sleeping()) {
+            worker.wake();
+            return true;
+        }
+    }
+
+    if (depth > g_server->settings.worker_grow_depth) {
+        grow();
+    }
+    return true;
+}
+
+bool
+WorkerPool::steal(Worker &thief, Worker::Job &job) {
+
+    const std::size_t count = _nbWorkers;
+    for (std::size_t i = 1; i < count; i++) {
+        if (_workers[(thief.id() + i) % count].steal(job)) {
+            Stats::inc(STAT_STOLEN_JOBS);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Takes a job from the worker's own queue or steals it from
+// others. If there are none, blocks till the worker is woken up
+// or worker_timeout (usec) passes, so server stop is noticed.
+// Job which has waited too long makes the pool grow.
+bool
+WorkerPool::take(Worker &worker, Worker::Job &job) {
+
+    const Settings &sets = g_server->settings;
+
+    if (worker.pop(job) || steal(worker, job)) {
+        if (Time::usec() - job.queued >= static_cast<uint64_t>(sets.worker_grow_wait)) {
+            grow();
+        }
+        return true;
+    }
+
+    worker.sleeping(true);
+    __sync_synchronize();
+
+    const bool taken = worker.pop(job) || steal(worker, job);
+    if (!taken && g_server->working()) {
+        worker.wait(sets.worker_timeout);
+    }
+
+    worker.sleeping(false);
+    return taken;
+}
+
+// Called by workers for every job leaving a queue,
+// including the dropped ones
+void
+WorkerPool::dequeued(long waitUs) {
+
+    __sync_fetch_and_sub(&_queued, 1);
+    __sync_fetch_and_add(&_jobs, 1);
+    __sync_fetch_and_add(&_waitUs, waitUs);
+    updateMax(&_waitMaxUs, waitUs);
+
+    Stats::inc(STAT_QUEUED_JOBS);
+    Stats::add(STAT_QUEUE_WAIT_US, waitUs);
+    Stats::max(STAT_QUEUE_WAIT_MAX_US, waitUs);
+}
+
+void
+WorkerPool::handled(long handleUs) {
+    __sync_fetch_and_add(&_handleUs, handleUs);
+    updateMax(&_handleMaxUs, handleUs);
+}
+
+void
+WorkerPool::print(void) {
+    Log.info() << "Pool " << _name << ":"
+               << " workers=" << _nbWorkers
+               << " queued=" << _queued
+               << " jobs=" << _jobs
+               << " rejected=" << _rejected
+               << " wait_us=" << _waitUs
+               << " wait_max_us=" << _waitMaxUs
+               << " handle_us=" << _handleUs
+               << " handle_max_us=" << _handleMaxUs << Log.endl;
+}